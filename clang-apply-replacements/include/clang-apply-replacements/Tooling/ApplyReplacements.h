@@ -50,9 +50,10 @@ typedef llvm::DenseMap<const clang::FileEntry *,
     FileToReplacementsMap;
 
 /// \brief Recursively descends through a directory structure rooted at \p
-/// Directory and attempts to deserialize *.yaml files as
-/// TranslationUnitReplacements. All docs that successfully deserialize are
-/// added to \p TUs.
+/// Directory and attempts to deserialize *.yaml files and files with the
+/// BinaryReplacementsExtension as TranslationUnitReplacements. Files in binary
+/// format are recognized by their contents whatever their extension. All docs
+/// that successfully deserialize are added to \p TUs.
 ///
 /// Directories starting with '.' are ignored during traversal.
 ///
@@ -72,6 +73,33 @@ collectReplacementsFromDirectory(const llvm::StringRef Directory,
                                  TUReplacementFiles &TURFiles,
                                  clang::DiagnosticsEngine &Diagnostics);
 
+/// \brief Like collectReplacementsFromDirectory() but groups the Replacements
+/// by the file they target as soon as each file is deserialized.
+///
+/// The files are deserialized on up to \p NumThreads threads. Exact
+/// duplicates are dropped while grouping, so memory use depends on the number
+/// of distinct Replacements rather than on the number of files read.
+/// Replacements targeting files that don't exist are reported and ignored.
+///
+/// \post For all (key,value) in GroupedReplacements, value[i] < value[i+1].
+///
+/// \param[in] Directory Directory to begin search for serialized
+/// TranslationUnitReplacements.
+/// \param[out] GroupedReplacements Container grouping all Replacements by the
+/// file they target.
+/// \param[out] TURFiles Collection of all TranslationUnitReplacement files
+/// found in \c Directory.
+/// \param[in] SM SourceManager used to look up the target files.
+/// \param[in] NumThreads Maximum number of threads to use. 0 means the number
+/// of hardware threads.
+///
+/// \returns An error_code indicating success or failure in navigating the
+/// directory structure.
+std::error_code collectGroupedReplacementsFromDirectory(
+    const llvm::StringRef Directory, FileToReplacementsMap &GroupedReplacements,
+    TUReplacementFiles &TURFiles, clang::SourceManager &SM,
+    unsigned NumThreads);
+
 /// \brief Deduplicate, check for conflicts, and apply all Replacements stored
 /// in \c TUs. If conflicts occur, no Replacements are applied.
 ///
@@ -90,6 +118,21 @@ bool mergeAndDeduplicate(const TUReplacements &TUs,
                          FileToReplacementsMap &GroupedReplacements,
                          clang::SourceManager &SM);
 
+/// \brief Deduplicate and check for conflicts among Replacements that are
+/// already grouped by the file they target. Conflicts are reported.
+///
+/// \post For all (key,value) in GroupedReplacements, value[i].getOffset() <=
+/// value[i+1].getOffset().
+///
+/// \param[in,out] GroupedReplacements Container grouping all Replacements by
+/// the file they target.
+/// \param[in] SM SourceManager required for conflict reporting.
+///
+/// \returns \li true If there were no conflicts.
+///          \li false If there were conflicts.
+bool deduplicateGroupedReplacements(FileToReplacementsMap &GroupedReplacements,
+                                    clang::SourceManager &SM);
+
 /// \brief Apply all replacements in \c GroupedReplacements.
 ///
 /// \param[in] GroupedReplacements Deduplicated and conflict free Replacements
@@ -102,6 +145,45 @@ bool mergeAndDeduplicate(const TUReplacements &TUs,
 bool applyReplacements(const FileToReplacementsMap &GroupedReplacements,
                        clang::Rewriter &Rewrites);
 
+/// \brief Apply \c Replacements and return the new file contents.
+///
+/// \pre Replacements[i].getFilePath() == Replacements[i+1].getFilePath().
+/// \post Replacements.empty() -> Result.empty()
+///
+/// \param[in] Replacements Replacements to apply.
+/// \param[out] Result Contents of the file after applying replacements if
+/// replacements were provided.
+/// \param[in] Diagnostics For diagnostic output.
+///
+/// \returns \li true if all replacements applied successfully.
+///          \li false if at least one replacement failed to apply.
+bool
+applyReplacements(const std::vector<clang::tooling::Replacement> &Replacements,
+                  std::string &Result, clang::DiagnosticsEngine &Diagnostics);
+
+/// \brief Apply code formatting to all places where replacements were made.
+///
+/// \pre !Replacements.empty().
+/// \pre Replacements[i].getFilePath() == Replacements[i+1].getFilePath().
+/// \pre Replacements[i].getOffset() <= Replacements[i+1].getOffset().
+///
+/// \param[in] Replacements Replacements that were made to the file. Provided
+/// to indicate where changes were made.
+/// \param[in] FileData The contents of the file \b after \c Replacements have
+/// been applied.
+/// \param[out] FormattedFileData The contents of the file after reformatting.
+/// \param[in] FormatStyle Style to apply.
+/// \param[in] Diagnostics For diagnostic output.
+///
+/// \returns \li true if reformatting replacements were all successfully
+///          applied.
+///          \li false if at least one reformatting replacement failed to apply.
+bool
+applyFormatting(const std::vector<clang::tooling::Replacement> &Replacements,
+                const llvm::StringRef FileData, std::string &FormattedFileData,
+                const clang::format::FormatStyle &FormatStyle,
+                clang::DiagnosticsEngine &Diagnostics);
+
 /// \brief Given a collection of Replacements for a single file, produces a list
 /// of source ranges that enclose those Replacements.
 ///
@@ -0,0 +1,72 @@
+//===-- BinaryReplacements.h - Compact replacements format ------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief This file provides the interface for reading and writing
+/// TranslationUnitReplacements in a compact binary format, an alternative to
+/// YAML for large sets of replacements.
+///
+/// The format is laid out as follows, all integers being ULEB128 encoded:
+///
+/// \code
+///   magic         "CRPL" followed by a version byte
+///   main source   length, bytes
+///   path table    count, then (length, bytes) for each path
+///   replacements  count, then (path index, offset, length, text length)
+///                 for each replacement
+///   text blob     replacement texts, concatenated in replacement order
+/// \endcode
+///
+/// Each file path is stored once however many replacements refer to it.
+/// Reading doesn't go through the YAML parser, but each replacement still
+/// copies its path and text out of the buffer, as tooling::Replacement owns
+/// them.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_APPLYREPLACEMENTS_BINARYREPLACEMENTS_H
+#define LLVM_CLANG_APPLYREPLACEMENTS_BINARYREPLACEMENTS_H
+
+#include "clang/Tooling/Refactoring.h"
+#include "llvm/ADT/StringRef.h"
+
+namespace llvm {
+class raw_ostream;
+} // end namespace llvm
+
+namespace clang {
+namespace replace {
+
+/// \brief Extension used for TranslationUnitReplacements files in binary
+/// format.
+extern const char BinaryReplacementsExtension[];
+
+/// \brief Checks whether \p Buffer starts like a TranslationUnitReplacements
+/// file in binary format.
+bool isBinaryReplacements(llvm::StringRef Buffer);
+
+/// \brief Writes \p TU to \p OS in binary format.
+void writeBinaryReplacements(
+    const clang::tooling::TranslationUnitReplacements &TU,
+    llvm::raw_ostream &OS);
+
+/// \brief Reads TranslationUnitReplacements in binary format.
+///
+/// \param[in] Buffer Contents of a file written by writeBinaryReplacements().
+/// \param[out] TU The deserialized replacements.
+///
+/// \returns \li true if \p Buffer was read successfully.
+///          \li false if \p Buffer is not in binary format or is malformed.
+bool readBinaryReplacements(llvm::StringRef Buffer,
+                            clang::tooling::TranslationUnitReplacements &TU);
+
+} // end namespace replace
+} // end namespace clang
+
+#endif // LLVM_CLANG_APPLYREPLACEMENTS_BINARYREPLACEMENTS_H
@@ -0,0 +1,60 @@
+//===-- WorkingDirectoryInvocation.h - Parallel tool runs -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief This file provides the interface for running a FrontendActionFactory
+/// on a compile command without changing the working directory of the
+/// process.
+///
+/// Unlike \c ClangTool::run, relative paths are resolved against the directory
+/// of each compile command using -working-directory, so several files can be
+/// processed concurrently. Used by the tools producing replacements when they
+/// process translation units in parallel.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_APPLYREPLACEMENTS_WORKINGDIRECTORYINVOCATION_H
+#define LLVM_CLANG_APPLYREPLACEMENTS_WORKINGDIRECTORYINVOCATION_H
+
+#include "llvm/ADT/StringRef.h"
+#include <string>
+#include <vector>
+
+namespace clang {
+
+class DiagnosticConsumer;
+
+namespace tooling {
+struct CompileCommand;
+class FrontendActionFactory;
+} // end namespace tooling
+
+namespace replace {
+
+/// \brief Returns the command line of a syntax-only invocation of \p Command
+/// that resolves relative paths against the directory of \p Command.
+std::vector<std::string>
+getWorkingDirectoryCommandLine(const tooling::CompileCommand &Command);
+
+/// \brief Runs \p Factory on \p CommandLine, as returned by
+/// \c getWorkingDirectoryCommandLine() for a compile command of \p Directory.
+///
+/// The diagnostics of the compiler are passed to \p DiagConsumer, or printed
+/// to stderr if it's null.
+///
+/// \returns true if the invocation succeeded.
+bool runInWorkingDirectory(std::vector<std::string> CommandLine,
+                           llvm::StringRef Directory,
+                           tooling::FrontendActionFactory *Factory,
+                           DiagnosticConsumer *DiagConsumer);
+
+} // end namespace replace
+} // end namespace clang
+
+#endif // LLVM_CLANG_APPLYREPLACEMENTS_WORKINGDIRECTORYINVOCATION_H
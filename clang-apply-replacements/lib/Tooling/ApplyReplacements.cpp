@@ -15,6 +15,7 @@
 ///
 //===----------------------------------------------------------------------===//
 #include "clang-apply-replacements/Tooling/ApplyReplacements.h"
+#include "clang-apply-replacements/Tooling/BinaryReplacements.h"
 #include "clang/Basic/LangOptions.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Format/Format.h"
@@ -25,7 +26,12 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 using namespace llvm;
 using namespace clang;
@@ -36,11 +42,11 @@ static void eatDiagnostics(const SMDiagnostic &, void *) {}
 namespace clang {
 namespace replace {
 
-std::error_code
-collectReplacementsFromDirectory(const llvm::StringRef Directory,
-                                 TUReplacements &TUs,
-                                 TUReplacementFiles & TURFiles,
-                                 clang::DiagnosticsEngine &Diagnostics) {
+/// \brief Appends the path of all *.yaml and binary replacements files found
+/// under \p Directory to \p Files. Directories starting with '.' are not
+/// descended into.
+static std::error_code findReplacementFiles(const llvm::StringRef Directory,
+                                            TUReplacementFiles &Files) {
   using namespace llvm::sys::fs;
   using namespace llvm::sys::path;
 
@@ -54,29 +60,130 @@ collectReplacementsFromDirectory(const llvm::StringRef Directory,
       continue;
     }
 
-    if (extension(I->path()) != ".yaml")
+    StringRef Extension = extension(I->path());
+    if (Extension != ".yaml" && Extension != BinaryReplacementsExtension)
       continue;
 
-    TURFiles.push_back(I->path());
+    Files.push_back(I->path());
+  }
 
-    ErrorOr<std::unique_ptr<MemoryBuffer>> Out =
-        MemoryBuffer::getFile(I->path());
-    if (std::error_code BufferError = Out.getError()) {
-      errs() << "Error reading " << I->path() << ": " << BufferError.message()
-             << "\n";
-      continue;
-    }
+  return ErrorCode;
+}
+
+/// \brief Deserializes the file \p Path as TranslationUnitReplacements. The
+/// binary format is detected from the file contents, YAML is assumed
+/// otherwise.
+///
+/// \param[in] Path File to read.
+/// \param[out] TU The deserialized replacements.
+/// \param[in] ErrorStream Read errors are written there.
+///
+/// \returns \li true if \p TU was read successfully.
+///          \li false if the file couldn't be read or doesn't appear to be a
+///          change description.
+static bool readTUReplacements(StringRef Path,
+                               tooling::TranslationUnitReplacements &TU,
+                               raw_ostream &ErrorStream) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Out = MemoryBuffer::getFile(Path);
+  if (std::error_code BufferError = Out.getError()) {
+    ErrorStream << "Error reading " << Path << ": " << BufferError.message()
+                << "\n";
+    return false;
+  }
+
+  StringRef Buffer = Out.get()->getBuffer();
+  if (isBinaryReplacements(Buffer))
+    return readBinaryReplacements(Buffer, TU);
 
-    yaml::Input YIn(Out.get()->getBuffer(), nullptr, &eatDiagnostics);
+  yaml::Input YIn(Buffer, nullptr, &eatDiagnostics);
+  YIn >> TU;
+  // A file that fails to parse isn't a header change description.
+  return !YIn.error();
+}
+
+std::error_code
+collectReplacementsFromDirectory(const llvm::StringRef Directory,
+                                 TUReplacements &TUs,
+                                 TUReplacementFiles & TURFiles,
+                                 clang::DiagnosticsEngine &Diagnostics) {
+  size_t FirstFile = TURFiles.size();
+  std::error_code ErrorCode = findReplacementFiles(Directory, TURFiles);
+
+  for (size_t I = FirstFile, E = TURFiles.size(); I != E; ++I) {
     tooling::TranslationUnitReplacements TU;
-    YIn >> TU;
-    if (YIn.error()) {
-      // File doesn't appear to be a header change description. Ignore it.
-      continue;
+    // Only keep files that properly parse.
+    if (readTUReplacements(TURFiles[I], TU, errs()))
+      TUs.push_back(TU);
+  }
+
+  return ErrorCode;
+}
+
+std::error_code collectGroupedReplacementsFromDirectory(
+    const llvm::StringRef Directory, FileToReplacementsMap &GroupedReplacements,
+    TUReplacementFiles &TURFiles, clang::SourceManager &SM,
+    unsigned NumThreads) {
+  size_t FirstFile = TURFiles.size();
+  std::error_code ErrorCode = findReplacementFiles(Directory, TURFiles);
+
+  // Replacements are grouped as soon as their file is parsed. Storing them in
+  // sets drops the exact duplicates coming from headers shared by many
+  // translation units right away.
+  llvm::DenseMap<const FileEntry *, tooling::Replacements> UniqueReplacements;
+  // Paths are resolved once. A null entry means the file doesn't exist.
+  llvm::StringMap<const FileEntry *> InternedPaths;
+  std::mutex GroupingMutex;
+  std::atomic<size_t> NextFile(FirstFile);
+
+  auto Worker = [&]() {
+    for (size_t I = NextFile++; I < TURFiles.size(); I = NextFile++) {
+      tooling::TranslationUnitReplacements TU;
+      std::string Errors;
+      llvm::raw_string_ostream ErrorStream(Errors);
+      bool Parsed = readTUReplacements(TURFiles[I], TU, ErrorStream);
+
+      std::lock_guard<std::mutex> Lock(GroupingMutex);
+      errs() << ErrorStream.str();
+      if (!Parsed)
+        continue;
+
+      for (const tooling::Replacement &R : TU.Replacements) {
+        const FileEntry *Entry;
+        auto Interned = InternedPaths.find(R.getFilePath());
+        if (Interned != InternedPaths.end()) {
+          Entry = Interned->second;
+        } else {
+          Entry = SM.getFileManager().getFile(R.getFilePath());
+          InternedPaths[R.getFilePath()] = Entry;
+          if (!Entry)
+            errs() << "Described file '" << R.getFilePath()
+                   << "' doesn't exist. Ignoring...\n";
+        }
+        if (Entry)
+          UniqueReplacements[Entry].insert(R);
+      }
     }
+  };
+
+  if (NumThreads == 0)
+    NumThreads = std::thread::hardware_concurrency();
+  NumThreads = std::min<size_t>(NumThreads, TURFiles.size() - FirstFile);
+  if (NumThreads > 1 && llvm::llvm_is_multithreaded()) {
+    std::vector<std::thread> Threads;
+    for (unsigned I = 0; I != NumThreads; ++I)
+      Threads.emplace_back(Worker);
+    for (std::thread &Thread : Threads)
+      Thread.join();
+  } else {
+    Worker();
+  }
 
-    // Only keep files that properly parse.
-    TUs.push_back(TU);
+  for (auto &FileAndReplacements : UniqueReplacements) {
+    std::vector<tooling::Replacement> &Replacements =
+        GroupedReplacements[FileAndReplacements.first];
+    Replacements.insert(Replacements.end(), FileAndReplacements.second.begin(),
+                        FileAndReplacements.second.end());
+    FileAndReplacements.second.clear();
   }
 
   return ErrorCode;
@@ -183,10 +290,12 @@ bool mergeAndDeduplicate(const TUReplacements &TUs,
   }
 
   // Ask clang to deduplicate and report conflicts.
-  if (deduplicateAndDetectConflicts(GroupedReplacements, SM))
-    return false;
+  return deduplicateGroupedReplacements(GroupedReplacements, SM);
+}
 
-  return true;
+bool deduplicateGroupedReplacements(FileToReplacementsMap &GroupedReplacements,
+                                    clang::SourceManager &SM) {
+  return !deduplicateAndDetectConflicts(GroupedReplacements, SM);
 }
 
 bool applyReplacements(const FileToReplacementsMap &GroupedReplacements,
@@ -206,6 +315,83 @@ bool applyReplacements(const FileToReplacementsMap &GroupedReplacements,
   return true;
 }
 
+/// \brief Convenience function to get rewritten content for \c Filename from
+/// \c Rewrites.
+///
+/// \pre Replacements[i].getFilePath() == Replacements[i+1].getFilePath().
+/// \post Replacements.empty() -> Result.empty()
+///
+/// \param[in] Replacements Replacements to apply
+/// \param[in] Rewrites Rewriter to use to apply replacements.
+/// \param[out] Result Contents of the file after applying replacements if
+/// replacements were provided.
+///
+/// \returns \li true if all replacements were applied successfully.
+///          \li false if at least one replacement failed to apply.
+static bool
+getRewrittenData(const std::vector<tooling::Replacement> &Replacements,
+                 Rewriter &Rewrites, std::string &Result) {
+  if (Replacements.empty()) return true;
+
+  if (!tooling::applyAllReplacements(Replacements, Rewrites))
+    return false;
+
+  SourceManager &SM = Rewrites.getSourceMgr();
+  FileManager &Files = SM.getFileManager();
+
+  StringRef FileName = Replacements.begin()->getFilePath();
+  const clang::FileEntry *Entry = Files.getFile(FileName);
+  assert(Entry && "Expected an existing file");
+  FileID ID = SM.translateFile(Entry);
+  assert(!ID.isInvalid() && "Expected a valid FileID");
+  const RewriteBuffer *Buffer = Rewrites.getRewriteBufferFor(ID);
+  Result = std::string(Buffer->begin(), Buffer->end());
+
+  return true;
+}
+
+bool applyReplacements(const std::vector<tooling::Replacement> &Replacements,
+                       std::string &Result,
+                       DiagnosticsEngine &Diagnostics) {
+  FileManager Files((FileSystemOptions()));
+  SourceManager SM(Diagnostics, Files);
+  Rewriter Rewrites(SM, LangOptions());
+
+  return getRewrittenData(Replacements, Rewrites, Result);
+}
+
+bool applyFormatting(const std::vector<tooling::Replacement> &Replacements,
+                     const StringRef FileData,
+                     std::string &FormattedFileData,
+                     const format::FormatStyle &FormatStyle,
+                     DiagnosticsEngine &Diagnostics) {
+  assert(!Replacements.empty() && "Need at least one replacement");
+
+  RangeVector Ranges = calculateChangedRanges(Replacements);
+
+  StringRef FileName = Replacements.begin()->getFilePath();
+  tooling::Replacements R =
+      format::reformat(FormatStyle, FileData, Ranges, FileName);
+
+  // FIXME: Remove this copy when tooling::Replacements is implemented as a
+  // vector instead of a set.
+  std::vector<tooling::Replacement> FormattingReplacements;
+  std::copy(R.begin(), R.end(), back_inserter(FormattingReplacements));
+
+  if (FormattingReplacements.empty()) {
+    FormattedFileData = FileData;
+    return true;
+  }
+
+  FileManager Files((FileSystemOptions()));
+  SourceManager SM(Diagnostics, Files);
+  SM.overrideFileContents(Files.getFile(FileName),
+                          llvm::MemoryBuffer::getMemBufferCopy(FileData));
+  Rewriter Rewrites(SM, LangOptions());
+
+  return getRewrittenData(FormattingReplacements, Rewrites, FormattedFileData);
+}
+
 RangeVector calculateChangedRanges(
     const std::vector<clang::tooling::Replacement> &Replaces) {
   RangeVector ChangedRanges;
@@ -0,0 +1,186 @@
+//===-- BinaryReplacements.cpp - Compact replacements format --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief This file provides the implementation for reading and writing
+/// TranslationUnitReplacements in binary format.
+///
+//===----------------------------------------------------------------------===//
+#include "clang-apply-replacements/Tooling/BinaryReplacements.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/raw_ostream.h"
+#include <climits>
+
+using namespace llvm;
+using namespace clang;
+
+static const char Magic[] = { 'C', 'R', 'P', 'L' };
+static const char Version = 1;
+
+namespace {
+
+/// \brief Reads ULEB128 integers and strings from a buffer, failing instead
+/// of reading past its end.
+class BufferReader {
+public:
+  BufferReader(StringRef Buffer) : Buffer(Buffer) {}
+
+  bool readInt(uint64_t &Result) {
+    Result = 0;
+    for (unsigned Shift = 0; Shift < 64; Shift += 7) {
+      if (Buffer.empty())
+        return false;
+      uint8_t Byte = Buffer.front();
+      Buffer = Buffer.drop_front();
+      Result |= uint64_t(Byte & 0x7f) << Shift;
+      if (!(Byte & 0x80))
+        return true;
+    }
+    return false;
+  }
+
+  bool readUnsigned(unsigned &Result) {
+    uint64_t Value;
+    if (!readInt(Value) || Value > UINT_MAX)
+      return false;
+    Result = Value;
+    return true;
+  }
+
+  bool readString(StringRef &Result) {
+    uint64_t Size;
+    if (!readInt(Size) || Size > Buffer.size())
+      return false;
+    Result = Buffer.substr(0, Size);
+    Buffer = Buffer.drop_front(Size);
+    return true;
+  }
+
+  StringRef getRemaining() const { return Buffer; }
+
+private:
+  StringRef Buffer;
+};
+
+} // end anonymous namespace
+
+static void writeString(StringRef S, raw_ostream &OS) {
+  encodeULEB128(S.size(), OS);
+  OS << S;
+}
+
+namespace clang {
+namespace replace {
+
+const char BinaryReplacementsExtension[] = ".fixes";
+
+bool isBinaryReplacements(StringRef Buffer) {
+  return Buffer.startswith(StringRef(Magic, sizeof(Magic)));
+}
+
+void writeBinaryReplacements(const tooling::TranslationUnitReplacements &TU,
+                             raw_ostream &OS) {
+  OS.write(Magic, sizeof(Magic));
+  OS << Version;
+  writeString(TU.MainSourceFile, OS);
+
+  // Assign an index to each distinct path in order of first use.
+  StringMap<unsigned> PathIndices;
+  std::vector<StringRef> Paths;
+  std::vector<unsigned> ReplacementPaths;
+  for (const tooling::Replacement &R : TU.Replacements) {
+    auto I = PathIndices.find(R.getFilePath());
+    if (I == PathIndices.end()) {
+      PathIndices[R.getFilePath()] = Paths.size();
+      ReplacementPaths.push_back(Paths.size());
+      Paths.push_back(R.getFilePath());
+    } else {
+      ReplacementPaths.push_back(I->second);
+    }
+  }
+
+  encodeULEB128(Paths.size(), OS);
+  for (StringRef Path : Paths)
+    writeString(Path, OS);
+
+  encodeULEB128(TU.Replacements.size(), OS);
+  for (unsigned I = 0, E = TU.Replacements.size(); I != E; ++I) {
+    const tooling::Replacement &R = TU.Replacements[I];
+    encodeULEB128(ReplacementPaths[I], OS);
+    encodeULEB128(R.getOffset(), OS);
+    encodeULEB128(R.getLength(), OS);
+    encodeULEB128(R.getReplacementText().size(), OS);
+  }
+
+  for (const tooling::Replacement &R : TU.Replacements)
+    OS << R.getReplacementText();
+}
+
+bool readBinaryReplacements(StringRef Buffer,
+                            tooling::TranslationUnitReplacements &TU) {
+  if (!isBinaryReplacements(Buffer))
+    return false;
+  Buffer = Buffer.drop_front(sizeof(Magic));
+  if (Buffer.empty() || Buffer.front() != Version)
+    return false;
+  BufferReader Reader(Buffer.drop_front());
+
+  StringRef MainSourceFile;
+  if (!Reader.readString(MainSourceFile))
+    return false;
+
+  // Every entry takes at least one byte, which bounds the counts of valid
+  // files by the buffer size.
+  uint64_t NumPaths;
+  if (!Reader.readInt(NumPaths) ||
+      NumPaths > Reader.getRemaining().size())
+    return false;
+  std::vector<StringRef> Paths(NumPaths);
+  for (StringRef &Path : Paths)
+    if (!Reader.readString(Path))
+      return false;
+
+  struct Entry {
+    unsigned PathIndex;
+    unsigned Offset;
+    unsigned Length;
+    unsigned TextLength;
+  };
+  uint64_t NumReplacements;
+  if (!Reader.readInt(NumReplacements) ||
+      NumReplacements > Reader.getRemaining().size())
+    return false;
+  std::vector<Entry> Entries(NumReplacements);
+  uint64_t TextSize = 0;
+  for (Entry &E : Entries) {
+    if (!Reader.readUnsigned(E.PathIndex) || E.PathIndex >= Paths.size() ||
+        !Reader.readUnsigned(E.Offset) || !Reader.readUnsigned(E.Length) ||
+        !Reader.readUnsigned(E.TextLength))
+      return false;
+    TextSize += E.TextLength;
+  }
+
+  StringRef Text = Reader.getRemaining();
+  if (Text.size() != TextSize)
+    return false;
+
+  TU.MainSourceFile = MainSourceFile;
+  TU.Replacements.clear();
+  TU.Replacements.reserve(Entries.size());
+  for (const Entry &E : Entries) {
+    TU.Replacements.push_back(tooling::Replacement(
+        Paths[E.PathIndex], E.Offset, E.Length, Text.substr(0, E.TextLength)));
+    Text = Text.drop_front(E.TextLength);
+  }
+  return true;
+}
+
+} // end namespace replace
+} // end namespace clang
@@ -0,0 +1,61 @@
+//===-- WorkingDirectoryInvocation.cpp - Parallel tool runs ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief This file provides the implementation for running a
+/// FrontendActionFactory on a compile command without changing the working
+/// directory of the process.
+///
+//===----------------------------------------------------------------------===//
+#include "clang-apply-replacements/Tooling/WorkingDirectoryInvocation.h"
+#include "clang/Basic/FileManager.h"
+#include "clang/Tooling/ArgumentsAdjusters.h"
+#include "clang/Tooling/CompilationDatabase.h"
+#include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/IntrusiveRefCntPtr.h"
+#include "llvm/Support/FileSystem.h"
+#include <cassert>
+
+using namespace llvm;
+using namespace clang;
+using namespace clang::tooling;
+
+std::vector<std::string>
+replace::getWorkingDirectoryCommandLine(const CompileCommand &Command) {
+  // Exists solely for the purpose of lookup of the resource path.
+  static int StaticSymbol;
+  std::string MainExecutable =
+      sys::fs::getMainExecutable("clang_tool", &StaticSymbol);
+
+  ClangSyntaxOnlyAdjuster SyntaxOnly;
+  ClangStripOutputAdjuster StripOutput;
+  ArgumentsAdjuster *Adjusters[] = { &SyntaxOnly, &StripOutput };
+
+  CommandLineArguments CommandLine = Command.CommandLine;
+  for (ArgumentsAdjuster *Adjuster : Adjusters)
+    CommandLine = Adjuster->Adjust(CommandLine);
+  assert(!CommandLine.empty());
+  CommandLine[0] = MainExecutable;
+  CommandLine.insert(CommandLine.begin() + 1, "-working-directory");
+  CommandLine.insert(CommandLine.begin() + 2, Command.Directory);
+  return CommandLine;
+}
+
+bool replace::runInWorkingDirectory(std::vector<std::string> CommandLine,
+                                    StringRef Directory,
+                                    FrontendActionFactory *Factory,
+                                    DiagnosticConsumer *DiagConsumer) {
+  FileSystemOptions FileSystemOpts;
+  FileSystemOpts.WorkingDir = Directory;
+  IntrusiveRefCntPtr<FileManager> Files(new FileManager(FileSystemOpts));
+  ToolInvocation Invocation(std::move(CommandLine), Factory, Files.get());
+  if (DiagConsumer)
+    Invocation.setDiagnosticConsumer(DiagConsumer);
+  return Invocation.run();
+}
@@ -23,6 +23,9 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Threading.h"
+#include <atomic>
+#include <thread>
 
 using namespace llvm;
 using namespace clang;
@@ -44,7 +47,15 @@ static cl::opt<bool> RemoveTUReplacementFiles(
 // here will get marked 'ReallyHidden' so they don't appear in any -help text.
 const char *OptionsToShow[] = { "help",                     "version",
                                 "remove-change-desc-files", "format",
-                                "style-config",             "style" };
+                                "style-config",             "style",
+                                "j" };
+
+static cl::opt<unsigned> NumThreads(
+    "j",
+    cl::desc("Number of threads used to read change description files\n"
+             "and to rewrite files. 0 means the number of hardware\n"
+             "threads."),
+    cl::init(1), cl::value_desc("N"));
 
 static cl::opt<bool> DoFormat(
     "format",
@@ -85,114 +96,40 @@ private:
   clang::DiagnosticsEngine &Diag;
 };
 
-void printVersion() {
-  outs() << "clang-apply-replacements version " CLANG_VERSION_STRING << "\n";
-}
-
-/// \brief Convenience function to get rewritten content for \c Filename from
-/// \c Rewrites.
-///
-/// \pre Replacements[i].getFilePath() == Replacements[i+1].getFilePath().
-/// \post Replacements.empty() -> Result.empty()
-///
-/// \param[in] Replacements Replacements to apply
-/// \param[in] Rewrites Rewriter to use to apply replacements.
-/// \param[out] Result Contents of the file after applying replacements if
-/// replacements were provided.
-///
-/// \returns \li true if all replacements were applied successfully.
-///          \li false if at least one replacement failed to apply.
-static bool
-getRewrittenData(const std::vector<tooling::Replacement> &Replacements,
-                 Rewriter &Rewrites, std::string &Result) {
-  if (Replacements.empty()) return true;
-
-  if (!tooling::applyAllReplacements(Replacements, Rewrites))
-    return false;
-
-  SourceManager &SM = Rewrites.getSourceMgr();
-  FileManager &Files = SM.getFileManager();
-
-  StringRef FileName = Replacements.begin()->getFilePath();
-  const clang::FileEntry *Entry = Files.getFile(FileName);
-  assert(Entry && "Expected an existing file");
-  FileID ID = SM.translateFile(Entry);
-  assert(!ID.isInvalid() && "Expected a valid FileID");
-  const RewriteBuffer *Buffer = Rewrites.getRewriteBufferFor(ID);
-  Result = std::string(Buffer->begin(), Buffer->end());
-
-  return true;
-}
-
-/// \brief Apply \c Replacements and return the new file contents.
-///
-/// \pre Replacements[i].getFilePath() == Replacements[i+1].getFilePath().
-/// \post Replacements.empty() -> Result.empty()
+/// \brief Applies \c Replacements to \c FileName, reformats the changed code
+/// if requested and writes the new contents to disk.
 ///
-/// \param[in] Replacements Replacements to apply.
-/// \param[out] Result Contents of the file after applying replacements if
-/// replacements were provided.
-/// \param[in] Diagnostics For diagnostic output.
+/// Uses no state shared with other files, so several files can be processed
+/// concurrently as long as each thread uses its own \c Diagnostics.
 ///
-/// \returns \li true if all replacements applied successfully.
-///          \li false if at least one replacement failed to apply.
-bool applyReplacements(const std::vector<tooling::Replacement> &Replacements,
-                       std::string &Result,
-                       DiagnosticsEngine &Diagnostics) {
-  FileManager Files((FileSystemOptions()));
-  SourceManager SM(Diagnostics, Files);
-  Rewriter Rewrites(SM, LangOptions());
-
-  return getRewrittenData(Replacements, Rewrites, Result);
+/// \returns An error message, or an empty string on success.
+static std::string
+rewriteFile(StringRef FileName,
+            const std::vector<tooling::Replacement> &Replacements,
+            const format::FormatStyle &FormatStyle,
+            DiagnosticsEngine &Diagnostics) {
+  std::string NewFileData;
+  if (!applyReplacements(Replacements, NewFileData, Diagnostics))
+    return ("Failed to apply replacements to " + FileName + "\n").str();
+
+  // Apply formatting if requested.
+  if (DoFormat && !applyFormatting(Replacements, NewFileData, NewFileData,
+                                   FormatStyle, Diagnostics))
+    return ("Failed to apply reformatting replacements for " + FileName +
+            "\n").str();
+
+  // Write new file to disk
+  std::error_code EC;
+  llvm::raw_fd_ostream FileStream(FileName, EC, llvm::sys::fs::F_Text);
+  if (EC)
+    return ("Could not open " + FileName + " for writing\n").str();
+
+  FileStream << NewFileData;
+  return std::string();
 }
 
-/// \brief Apply code formatting to all places where replacements were made.
-///
-/// \pre !Replacements.empty().
-/// \pre Replacements[i].getFilePath() == Replacements[i+1].getFilePath().
-/// \pre Replacements[i].getOffset() <= Replacements[i+1].getOffset().
-///
-/// \param[in] Replacements Replacements that were made to the file. Provided
-/// to indicate where changes were made.
-/// \param[in] FileData The contents of the file \b after \c Replacements have
-/// been applied.
-/// \param[out] FormattedFileData The contents of the file after reformatting.
-/// \param[in] FormatStyle Style to apply.
-/// \param[in] Diagnostics For diagnostic output.
-///
-/// \returns \li true if reformatting replacements were all successfully
-///          applied.
-///          \li false if at least one reformatting replacement failed to apply.
-bool applyFormatting(const std::vector<tooling::Replacement> &Replacements,
-                     const StringRef FileData,
-                     std::string &FormattedFileData,
-                     const format::FormatStyle &FormatStyle,
-                     DiagnosticsEngine &Diagnostics) {
-  assert(!Replacements.empty() && "Need at least one replacement");
-
-  RangeVector Ranges = calculateChangedRanges(Replacements);
-
-  StringRef FileName = Replacements.begin()->getFilePath();
-  tooling::Replacements R =
-      format::reformat(FormatStyle, FileData, Ranges, FileName);
-
-  // FIXME: Remove this copy when tooling::Replacements is implemented as a
-  // vector instead of a set.
-  std::vector<tooling::Replacement> FormattingReplacements;
-  std::copy(R.begin(), R.end(), back_inserter(FormattingReplacements));
-
-  if (FormattingReplacements.empty()) {
-    FormattedFileData = FileData;
-    return true;
-  }
-
-  FileManager Files((FileSystemOptions()));
-  SourceManager SM(Diagnostics, Files);
-  SM.overrideFileContents(Files.getFile(FileName),
-                          llvm::MemoryBuffer::getMemBufferCopy(FileData));
-  Rewriter Rewrites(SM, LangOptions());
-
-  return getRewrittenData(FormattingReplacements, Rewrites, FormattedFileData);
+void printVersion() {
+  outs() << "clang-apply-replacements version " CLANG_VERSION_STRING << "\n";
 }
 
 int main(int argc, char **argv) {
@@ -218,11 +155,16 @@ int main(int argc, char **argv) {
   if (DoFormat)
     FormatStyle = format::getStyle(FormatStyleOpt, FormatStyleConfig, "LLVM");
 
-  TUReplacements TUs;
+  FileManager Files((FileSystemOptions()));
+  SourceManager SM(Diagnostics, Files);
+
+  // Replacements are grouped by target file while the change description
+  // files are read, instead of loading all of them first.
+  FileToReplacementsMap GroupedReplacements;
   TUReplacementFiles TURFiles;
 
-  std::error_code ErrorCode =
-      collectReplacementsFromDirectory(Directory, TUs, TURFiles, Diagnostics);
+  std::error_code ErrorCode = collectGroupedReplacementsFromDirectory(
+      Directory, GroupedReplacements, TURFiles, SM, NumThreads);
 
   if (ErrorCode) {
     errs() << "Trouble iterating over directory '" << Directory
@@ -236,48 +178,52 @@ int main(int argc, char **argv) {
   if (RemoveTUReplacementFiles)
     Remover.reset(new ScopedFileRemover(TURFiles, Diagnostics));
 
-  FileManager Files((FileSystemOptions()));
-  SourceManager SM(Diagnostics, Files);
-
-  FileToReplacementsMap GroupedReplacements;
-  if (!mergeAndDeduplicate(TUs, GroupedReplacements, SM))
+  if (!deduplicateGroupedReplacements(GroupedReplacements, SM))
     return 1;
 
-  Rewriter ReplacementsRewriter(SM, LangOptions());
-
+  // Files are independent once replacements are deduplicated. Each worker
+  // takes the next file from a shared counter and error messages are printed
+  // in a fixed order once all workers are done.
+  std::vector<const FileToReplacementsMap::value_type *> FilesToRewrite;
   for (const auto &FileAndReplacements : GroupedReplacements) {
     // This shouldn't happen but if a file somehow has no replacements skip to
     // next file.
-    if (FileAndReplacements.second.empty())
-      continue;
-
-    std::string NewFileData;
-    const char *FileName = FileAndReplacements.first->getName();
-    if (!applyReplacements(FileAndReplacements.second, NewFileData,
-                           Diagnostics)) {
-      errs() << "Failed to apply replacements to " << FileName << "\n";
-      continue;
-    }
-
-    // Apply formatting if requested.
-    if (DoFormat &&
-        !applyFormatting(FileAndReplacements.second, NewFileData, NewFileData,
-                         FormatStyle, Diagnostics)) {
-      errs() << "Failed to apply reformatting replacements for " << FileName
-             << "\n";
-      continue;
-    }
-
-    // Write new file to disk
-    std::error_code EC;
-    llvm::raw_fd_ostream FileStream(FileName, EC, llvm::sys::fs::F_Text);
-    if (EC) {
-      llvm::errs() << "Could not open " << FileName << " for writing\n";
-      continue;
-    }
-
-    FileStream << NewFileData;
+    if (!FileAndReplacements.second.empty())
+      FilesToRewrite.push_back(&FileAndReplacements);
+  }
+
+  std::vector<std::string> Errors(FilesToRewrite.size());
+  std::atomic<unsigned> NextFile(0);
+  auto Worker = [&]() {
+    // Reference counts aren't atomic, so the workers don't share the options
+    // of Diagnostics.
+    IntrusiveRefCntPtr<DiagnosticOptions> WorkerDiagOpts(
+        new DiagnosticOptions(*DiagOpts));
+    DiagnosticsEngine WorkerDiagnostics(
+        IntrusiveRefCntPtr<DiagnosticIDs>(new DiagnosticIDs()),
+        WorkerDiagOpts.get());
+    for (unsigned I = NextFile++; I < FilesToRewrite.size(); I = NextFile++)
+      Errors[I] = rewriteFile(FilesToRewrite[I]->first->getName(),
+                              FilesToRewrite[I]->second, FormatStyle,
+                              WorkerDiagnostics);
+  };
+
+  unsigned NumWorkers = NumThreads;
+  if (NumWorkers == 0)
+    NumWorkers = std::thread::hardware_concurrency();
+  NumWorkers = std::min<size_t>(NumWorkers, FilesToRewrite.size());
+  if (NumWorkers > 1 && llvm::llvm_is_multithreaded()) {
+    std::vector<std::thread> Threads;
+    for (unsigned I = 0; I != NumWorkers; ++I)
+      Threads.emplace_back(Worker);
+    for (std::thread &Thread : Threads)
+      Thread.join();
+  } else {
+    Worker();
   }
 
+  for (const std::string &Error : Errors)
+    errs() << Error;
+
   return 0;
 }
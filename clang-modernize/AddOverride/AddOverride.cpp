@@ -28,25 +28,11 @@ static cl::opt<bool> DetectMacros(
     cl::desc("Detect and use macros that expand to the 'override' keyword."),
     cl::cat(TransformsOptionsCategory));
 
-int AddOverrideTransform::apply(const CompilationDatabase &Database,
-                                const std::vector<std::string> &SourcePaths) {
-  ClangTool AddOverrideTool(Database, SourcePaths);
-  unsigned AcceptedChanges = 0;
-  MatchFinder Finder;
-  AddOverrideFixer Fixer(AcceptedChanges, DetectMacros,
-                         /*Owner=*/ *this);
-  Finder.addMatcher(makeCandidateForOverrideAttrMatcher(), &Fixer);
-
-  // Make Fixer available to handleBeginSource().
-  this->Fixer = &Fixer;
-
-  if (int result = AddOverrideTool.run(createActionFactory(Finder).get())) {
-    llvm::errs() << "Error encountered during translation.\n";
-    return result;
-  }
-
-  setAcceptedChanges(AcceptedChanges);
-  return 0;
+void AddOverrideTransform::registerMatchers(MatchFinder &Finder) {
+  // The Fixer is also used by handleBeginSource().
+  Fixer.reset(new AddOverrideFixer(acceptedChanges(), DetectMacros,
+                                   /*Owner=*/ *this));
+  Finder.addMatcher(makeCandidateForOverrideAttrMatcher(), Fixer.get());
 }
 
 bool AddOverrideTransform::handleBeginSource(clang::CompilerInstance &CI,
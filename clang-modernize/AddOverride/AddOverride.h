@@ -30,15 +30,20 @@ public:
   AddOverrideTransform(const TransformOptions &Options)
       : Transform("AddOverride", Options) {}
 
-  /// \see Transform::run().
-  virtual int apply(const clang::tooling::CompilationDatabase &Database,
-                    const std::vector<std::string> &SourcePaths) override;
+  /// \see Transform::registerMatchers().
+  virtual void
+  registerMatchers(clang::ast_matchers::MatchFinder &Finder) override;
+
+  /// \see Transform::createShard().
+  virtual Transform *createShard() override {
+    return new AddOverrideTransform(Options());
+  }
 
   virtual bool handleBeginSource(clang::CompilerInstance &CI,
                                  llvm::StringRef Filename) override;
 
 private:
-  AddOverrideFixer *Fixer;
+  std::unique_ptr<AddOverrideFixer> Fixer;
 };
 
 #endif // CLANG_MODERNIZE_ADD_OVERRIDE_H
@@ -13,33 +13,21 @@
 //===----------------------------------------------------------------------===//
 
 #include "Core/ReplacementHandling.h"
+#include "clang-apply-replacements/Tooling/BinaryReplacements.h"
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/DiagnosticOptions.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Format/Format.h"
 #include "clang/Tooling/ReplacementsYaml.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Path.h"
-#include "llvm/Support/Program.h"
 #include <system_error>
 
 using namespace llvm;
 using namespace llvm::sys;
 using namespace clang::tooling;
 
-bool ReplacementHandling::findClangApplyReplacements(const char *Argv0) {
-  CARPath = FindProgramByName("clang-apply-replacements");
-
-  if (!CARPath.empty())
-    return true;
-
-  static int StaticSymbol;
-  std::string ClangModernizePath = fs::getMainExecutable(Argv0, &StaticSymbol);
-  SmallString<128> TestPath = path::parent_path(ClangModernizePath);
-  path::append(TestPath, "clang-apply-replacements");
-  if (fs::can_execute(Twine(TestPath)))
-    CARPath = TestPath.str();
-
-  return !CARPath.empty();
-}
-
 StringRef ReplacementHandling::useTempDestinationDir() {
   DestinationDir = generateTempDir();
   return DestinationDir;
@@ -63,9 +51,10 @@ bool ReplacementHandling::serializeReplacements(
        I != E; ++I) {
     SmallString<128> ReplacementsFileName;
     SmallString<64> Error;
-    bool Result = generateReplacementsFileName(DestinationDir,
-                                               I->getValue().MainSourceFile,
-                                               ReplacementsFileName, Error);
+    bool Result = generateReplacementsFileName(
+        DestinationDir, I->getValue().MainSourceFile, ReplacementsFileName,
+        Error,
+        BinaryFormat ? clang::replace::BinaryReplacementsExtension : ".yaml");
     if (!Result) {
       errs() << "Failed to generate replacements filename:" << Error << "\n";
       Errors = true;
@@ -79,52 +68,77 @@ bool ReplacementHandling::serializeReplacements(
       Errors = true;
       continue;
     }
+    if (BinaryFormat) {
+      clang::replace::writeBinaryReplacements(I->getValue(), ReplacementsFile);
+      continue;
+    }
     yaml::Output YAML(ReplacementsFile);
     YAML << const_cast<TranslationUnitReplacements &>(I->getValue());
   }
   return !Errors;
 }
 
+void
+ReplacementHandling::addReplacements(const TUReplacementsMap &Replacements) {
+  for (const auto &Entry : Replacements)
+    PendingTUs.push_back(Entry.getValue());
+}
+
 bool ReplacementHandling::applyReplacements() {
-  SmallVector<const char *, 8> Argv;
-  Argv.push_back(CARPath.c_str());
-  std::string Style = "--style=" + FormatStyle;
-  std::string StyleConfig = "--style-config=" + StyleConfigDir;
-  if (DoFormat) {
-    Argv.push_back("--format");
-    Argv.push_back(Style.c_str());
-    if (!StyleConfigDir.empty())
-      Argv.push_back(StyleConfig.c_str());
-  }
-  Argv.push_back("--remove-change-desc-files");
-  Argv.push_back(DestinationDir.c_str());
-
-  // Argv array needs to be null terminated.
-  Argv.push_back(nullptr);
-
-  std::string ErrorMsg;
-  bool ExecutionFailed = false;
-  int ReturnCode = ExecuteAndWait(CARPath.c_str(), Argv.data(),
-                                  /* env */ nullptr, /* redirects */ nullptr,
-                                  /* secondsToWait */ 0, /* memoryLimit */ 0,
-                                  &ErrorMsg, &ExecutionFailed);
-  if (ExecutionFailed || !ErrorMsg.empty()) {
-    errs() << "Failed to launch clang-apply-replacements: " << ErrorMsg << "\n";
-    errs() << "Command Line:\n";
-    for (const char **I = Argv.begin(), **E = Argv.end(); I != E; ++I) {
-      if (*I)
-        errs() << *I << "\n";
-    }
+  IntrusiveRefCntPtr<clang::DiagnosticOptions> DiagOpts(
+      new clang::DiagnosticOptions());
+  clang::DiagnosticsEngine Diagnostics(
+      IntrusiveRefCntPtr<clang::DiagnosticIDs>(new clang::DiagnosticIDs()),
+      DiagOpts.get());
+  clang::FileManager Files((clang::FileSystemOptions()));
+  clang::SourceManager SM(Diagnostics, Files);
+
+  clang::replace::FileToReplacementsMap GroupedReplacements;
+  bool Merged =
+      clang::replace::mergeAndDeduplicate(PendingTUs, GroupedReplacements, SM);
+  PendingTUs.clear();
+  if (!Merged)
     return false;
-  }
 
-  if (ReturnCode != 0) {
-    errs() << "clang-apply-replacements failed with return code " << ReturnCode
-           << "\n";
-    return false;
+  clang::format::FormatStyle Style;
+  if (DoFormat)
+    Style = clang::format::getStyle(FormatStyle, StyleConfigDir, "LLVM");
+
+  bool Success = true;
+  for (const auto &FileAndReplacements : GroupedReplacements) {
+    if (FileAndReplacements.second.empty())
+      continue;
+
+    std::string NewFileData;
+    const char *FileName = FileAndReplacements.first->getName();
+    if (!clang::replace::applyReplacements(FileAndReplacements.second,
+                                           NewFileData, Diagnostics)) {
+      errs() << "Failed to apply replacements to " << FileName << "\n";
+      Success = false;
+      continue;
+    }
+
+    if (DoFormat &&
+        !clang::replace::applyFormatting(FileAndReplacements.second,
+                                         NewFileData, NewFileData, Style,
+                                         Diagnostics)) {
+      errs() << "Failed to apply reformatting replacements for " << FileName
+             << "\n";
+      Success = false;
+      continue;
+    }
+
+    std::error_code EC;
+    raw_fd_ostream FileStream(FileName, EC, fs::F_Text);
+    if (EC) {
+      errs() << "Could not open " << FileName << " for writing\n";
+      Success = false;
+      continue;
+    }
+    FileStream << NewFileData;
   }
 
-  return true;
+  return Success;
 }
 
 std::string ReplacementHandling::generateTempDir() {
@@ -138,13 +152,15 @@ std::string ReplacementHandling::generateTempDir() {
 
 bool ReplacementHandling::generateReplacementsFileName(
     StringRef DestinationDir, StringRef MainSourceFile,
-    SmallVectorImpl<char> &Result, SmallVectorImpl<char> &Error) {
+    SmallVectorImpl<char> &Result, SmallVectorImpl<char> &Error,
+    StringRef Extension) {
 
   Error.clear();
   SmallString<128> Prefix = DestinationDir;
   path::append(Prefix, path::filename(MainSourceFile));
   if (std::error_code EC =
-          fs::createUniqueFile(Prefix + "_%%_%%_%%_%%_%%_%%.yaml", Result)) {
+          fs::createUniqueFile(Prefix + "_%%_%%_%%_%%_%%_%%" + Extension,
+                               Result)) {
     const std::string &Msg = EC.message();
     Error.append(Msg.begin(), Msg.end());
     return false;
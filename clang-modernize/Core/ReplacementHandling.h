@@ -9,7 +9,7 @@
 ///
 /// \file
 /// \brief This file defines the ReplacementHandling class which abstracts
-/// serialization and application of serialized replacements.
+/// serialization and application of replacements.
 ///
 //===----------------------------------------------------------------------===//
 
@@ -17,23 +17,13 @@
 #define CLANG_MODERNIZE_REPLACEMENTHANDLING_H
 
 #include "Core/Transform.h"
+#include "clang-apply-replacements/Tooling/ApplyReplacements.h"
 #include "llvm/ADT/StringRef.h"
 
 class ReplacementHandling {
 public:
 
-  ReplacementHandling() : DoFormat(false) {}
-
-  /// \brief Finds the path to the executable 'clang-apply-replacements'.
-  ///
-  /// The executable is searched for on the PATH. If not found, looks in the
-  /// same directory as the image used to start the current executable.
-  ///
-  /// \param[in] Argv0 argv[0] as passed to main().
-  ///
-  /// \returns \li true if clang-apply-replacements was found.
-  ///          \li false otherwise.
-  bool findClangApplyReplacements(const char *Argv0);
+  ReplacementHandling() : DoFormat(false), BinaryFormat(false) {}
 
   /// \brief Set the name of the directory in which replacements will be
   /// serialized.
@@ -46,16 +36,20 @@ public:
   /// \returns The name of the directory createdy.
   llvm::StringRef useTempDestinationDir();
 
-  /// \brief Enable clang-apply-replacements do code reformatting when applying
-  /// serialized replacements.
+  /// \brief Enable code reformatting of the changed code when applying
+  /// replacements.
   ///
-  /// \param[in] Style Value to pass to clang-apply-replacement's --style
-  /// option.
-  /// \param[in] StyleConfigDir If non-empty, value to pass to
-  /// clang-apply-replacement's --style-config option.
+  /// \param[in] Style Name of the formatting style, as accepted by
+  /// clang-format's -style option.
+  /// \param[in] StyleConfigDir If non-empty, directory to search for a
+  /// .clang-format file when \p Style is 'file'.
   void enableFormatting(llvm::StringRef Style,
                         llvm::StringRef StyleConfigDir = "");
 
+  /// \brief Serialize replacements in the compact binary format understood
+  /// by clang-apply-replacements instead of YAML.
+  void enableBinaryFormat() { BinaryFormat = true; }
+
   /// \brief Write all TranslationUnitReplacements stored in \c Replacements
   /// to disk.
   /// 
@@ -70,14 +64,19 @@ public:
   ///          \li false otherwise.
   bool serializeReplacements(const TUReplacementsMap &Replacements);
 
-  /// \brief Invoke clang-apply-replacements to apply all serialized
-  /// replacements stored in the destination directory.
+  /// \brief Queue all TranslationUnitReplacements stored in \c Replacements
+  /// for the next call to applyReplacements().
   ///
-  /// \pre Destination directory must have been previously set by calling
-  /// setDestiantionDir() or useTempDestinationDir().
+  /// \param[in] Replacements Container of replacements to apply.
+  void addReplacements(const TUReplacementsMap &Replacements);
+
+  /// \brief Deduplicate and apply all queued replacements in memory, then
+  /// write the changed files to disk.
+  ///
+  /// If conflicting replacements are found, they are reported and no file is
+  /// changed. The queue is empty afterwards.
   ///
-  /// \returns \li true if clang-apply-replacements was successfully launched
-  ///          and successfully completed.
+  /// \returns \li true if all replacements were successfully applied.
   ///          \li false otherwise.
   bool applyReplacements();
 
@@ -86,7 +85,7 @@ public:
   /// Generates a unique filename in \c DestinationDir. The filename is generated
   /// following this pattern:
   ///
-  /// DestinationDir/Prefix_%%_%%_%%_%%_%%_%%.yaml
+  /// DestinationDir/Prefix_%%_%%_%%_%%_%%_%%Extension
   ///
   /// where Prefix := llvm::sys::path::filename(MainSourceFile) and all '%' will
   /// be replaced by a randomly chosen hex digit.
@@ -96,13 +95,15 @@ public:
   /// \param[out] Result The resulting unique filename.
   /// \param[out] Error If an error occurs a description of that error is
   ///             placed in this string.
+  /// \param[in] Extension Extension of the filename, including the dot.
   ///
   /// \returns \li true on success
   ///          \li false if a unique file name could not be created.
   static bool generateReplacementsFileName(llvm::StringRef DestinationDir,
                                            llvm::StringRef MainSourceFile,
                                            llvm::SmallVectorImpl<char> &Result,
-                                           llvm::SmallVectorImpl<char> &Error);
+                                           llvm::SmallVectorImpl<char> &Error,
+                                           llvm::StringRef Extension = ".yaml");
 
   /// \brief Helper to create a temporary directory name.
   ///
@@ -113,9 +114,10 @@ public:
 
 private:
 
-  std::string CARPath;
+  clang::replace::TUReplacements PendingTUs;
   std::string DestinationDir;
   bool DoFormat;
+  bool BinaryFormat;
   std::string FormatStyle;
   std::string StyleConfigDir;
 };
@@ -14,12 +14,22 @@
 //===----------------------------------------------------------------------===//
 
 #include "Core/Transform.h"
+#include "clang-apply-replacements/Tooling/WorkingDirectoryInvocation.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
 #include "clang/Basic/LangOptions.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/TextDiagnosticPrinter.h"
 #include "clang/Tooling/Tooling.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <thread>
 
 template class llvm::Registry<TransformFactory>;
 
@@ -33,21 +43,21 @@ using namespace tooling;
 using namespace ast_matchers;
 
 /// \brief Custom FrontendActionFactory to produce FrontendActions that simply
-/// forward (Begin|End)SourceFileAction calls to a given Transform.
+/// forward (Begin|End)SourceFileAction calls to the given Transforms.
 class ActionFactory : public clang::tooling::FrontendActionFactory {
 public:
-  ActionFactory(MatchFinder &Finder, Transform &Owner)
-  : Finder(Finder), Owner(Owner) {}
+  ActionFactory(MatchFinder &Finder, llvm::ArrayRef<Transform *> Owners)
+      : Finder(Finder), Owners(Owners.begin(), Owners.end()) {}
 
   virtual FrontendAction *create() override {
-    return new FactoryAdaptor(Finder, Owner);
+    return new FactoryAdaptor(Finder, Owners);
   }
 
 private:
   class FactoryAdaptor : public ASTFrontendAction {
   public:
-    FactoryAdaptor(MatchFinder &Finder, Transform &Owner)
-        : Finder(Finder), Owner(Owner) {}
+    FactoryAdaptor(MatchFinder &Finder, llvm::ArrayRef<Transform *> Owners)
+        : Finder(Finder), Owners(Owners) {}
 
     std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance &,
                                                    StringRef) override {
@@ -59,22 +69,242 @@ private:
       if (!ASTFrontendAction::BeginSourceFileAction(CI, Filename))
         return false;
 
-      return Owner.handleBeginSource(CI, Filename);
+      for (Transform *Owner : Owners)
+        if (!Owner->handleBeginSource(CI, Filename))
+          return false;
+      return true;
     }
 
     virtual void EndSourceFileAction() override {
-      Owner.handleEndSource();
+      for (Transform *Owner : Owners)
+        Owner->handleEndSource();
       return ASTFrontendAction::EndSourceFileAction();
     }
 
   private:
     MatchFinder &Finder;
-    Transform &Owner;
+    llvm::ArrayRef<Transform *> Owners;
   };
 
   MatchFinder &Finder;
-  Transform &Owner;
+  std::vector<Transform *> Owners;
 };
+
+/// \brief Runs \p Factory on all compile commands for \p FilePath.
+///
+/// Unlike \c ClangTool::run, this doesn't change the working directory of the
+/// process, so several files can be processed concurrently. Diagnostics are
+/// passed to \p DiagConsumer and other messages are written to \p OS.
+///
+/// \returns \li true if successful or if there is no compile command
+///          \li false if a compile command failed
+bool runToolOnFile(const CompilationDatabase &Database, StringRef FilePath,
+                   FrontendActionFactory &Factory,
+                   DiagnosticConsumer &DiagConsumer, llvm::raw_ostream &OS) {
+  std::vector<CompileCommand> Commands = Database.getCompileCommands(FilePath);
+  if (Commands.empty()) {
+    OS << "Skipping " << FilePath << ". Compile command not found.\n";
+    return true;
+  }
+
+  bool Success = true;
+  for (const CompileCommand &Command : Commands) {
+    if (!replace::runInWorkingDirectory(
+            replace::getWorkingDirectoryCommandLine(Command), Command.Directory,
+            &Factory, &DiagConsumer)) {
+      OS << "Error while processing " << FilePath << ".\n";
+      Success = false;
+    }
+  }
+  return Success;
+}
+
+/// \brief Computes the number of worker threads to use for \p NumSources
+/// sources. A result lower than 2 means the sources are processed serially.
+unsigned getNumThreads(const TransformOptions &Options, size_t NumSources) {
+  if (!llvm::llvm_is_multithreaded())
+    return 1;
+  unsigned NumThreads = Options.NumThreads;
+  if (NumThreads == 0)
+    NumThreads = std::thread::hardware_concurrency();
+  return std::min<size_t>(NumThreads, NumSources);
+}
+
+/// \brief Applies \p Transforms to \p SourcePaths on \p NumThreads worker
+/// threads.
+///
+/// Each worker owns one shard of every transform and a MatchFinder running the
+/// matchers of all its shards. Workers take source files from a shared
+/// counter, so each translation unit is processed by exactly one shard. Once
+/// all workers are done, the shards are merged back into \p Transforms in a
+/// fixed order without any locking.
+///
+/// The diagnostics and messages of each source file are buffered and printed
+/// in the order of \p SourcePaths, once the files before it are done.
+///
+/// \returns \li 0 if successful
+///          \li 1 if a translation unit failed to process
+///          \li -1 if one of the transforms doesn't support sharding, in which
+///          case nothing was processed.
+int applyInParallel(llvm::ArrayRef<Transform *> Transforms,
+                    const CompilationDatabase &Database,
+                    const std::vector<std::string> &SourcePaths,
+                    unsigned NumThreads) {
+  typedef std::vector<std::unique_ptr<Transform>> ShardVec;
+  std::vector<ShardVec> WorkerShards(NumThreads);
+  for (ShardVec &Shards : WorkerShards) {
+    for (Transform *T : Transforms) {
+      Transform *Shard = T->createShard();
+      if (!Shard)
+        return -1;
+      Shards.emplace_back(Shard);
+    }
+  }
+
+  // getAbsolutePath depends on the working directory, resolve all paths
+  // before starting any worker.
+  std::vector<std::string> AbsolutePaths;
+  for (const std::string &Path : SourcePaths)
+    AbsolutePaths.push_back(getAbsolutePath(Path));
+
+  // The output of the files done while an earlier one is still processed.
+  std::mutex OutputMutex;
+  std::vector<std::string> FileOutput(AbsolutePaths.size());
+  std::vector<bool> FileDone(AbsolutePaths.size());
+  unsigned NextToPrint = 0;
+  auto PrintOutput = [&](unsigned I, std::string Output) {
+    std::lock_guard<std::mutex> Lock(OutputMutex);
+    FileOutput[I] = std::move(Output);
+    FileDone[I] = true;
+    for (; NextToPrint < AbsolutePaths.size() && FileDone[NextToPrint];
+         ++NextToPrint) {
+      llvm::errs() << FileOutput[NextToPrint];
+      std::string().swap(FileOutput[NextToPrint]);
+    }
+  };
+
+  std::atomic<unsigned> NextFile(0);
+  std::atomic<bool> Failed(false);
+  auto Worker = [&](ShardVec &Shards) {
+    MatchFinder Finder;
+    std::vector<Transform *> Owners;
+    for (const std::unique_ptr<Transform> &Shard : Shards) {
+      Shard->Reset();
+      Shard->registerMatchers(Finder);
+      Owners.push_back(Shard.get());
+    }
+
+    ActionFactory Factory(Finder, Owners);
+    std::string Output;
+    llvm::raw_string_ostream OS(Output);
+    TextDiagnosticPrinter DiagPrinter(OS, new DiagnosticOptions());
+    for (unsigned I = NextFile++; I < AbsolutePaths.size(); I = NextFile++) {
+      if (!runToolOnFile(Database, AbsolutePaths[I], Factory, DiagPrinter, OS))
+        Failed = true;
+      OS.flush();
+      PrintOutput(I, std::move(Output));
+      Output.clear();
+    }
+  };
+
+  std::vector<std::thread> Threads;
+  for (ShardVec &Shards : WorkerShards)
+    Threads.emplace_back(Worker, std::ref(Shards));
+  for (std::thread &Thread : Threads)
+    Thread.join();
+
+  for (Transform *T : Transforms)
+    T->Reset();
+  for (const ShardVec &Shards : WorkerShards)
+    for (unsigned I = 0, E = Transforms.size(); I != E; ++I)
+      Transforms[I]->mergeShard(*Shards[I]);
+
+  if (Failed) {
+    llvm::errs() << "Error encountered during translation.\n";
+    return 1;
+  }
+  return 0;
+}
+
+/// \brief Returns true if replacements made by different \p Transforms in the
+/// translation unit of \p SourcePath can't be applied together.
+///
+/// Identical replacements don't conflict since they are deduplicated. An
+/// insertion at the start of another replacement does, as the order in which
+/// they would be applied is unspecified.
+bool haveOverlappingReplacements(llvm::ArrayRef<Transform *> Transforms,
+                                 StringRef SourcePath) {
+  typedef std::pair<const Replacement *, unsigned> OwnedReplacement;
+  std::vector<OwnedReplacement> All;
+  for (unsigned I = 0, E = Transforms.size(); I != E; ++I) {
+    const TUReplacementsMap &Map = Transforms[I]->getAllReplacements();
+    auto TU = Map.find(SourcePath);
+    if (TU == Map.end())
+      continue;
+    for (const Replacement &R : TU->getValue().Replacements)
+      All.push_back(std::make_pair(&R, I));
+  }
+
+  // Sorting by file, offset, length and text makes identical replacements
+  // adjacent.
+  std::sort(All.begin(), All.end(),
+            [](const OwnedReplacement &LHS, const OwnedReplacement &RHS) {
+    return *LHS.first < *RHS.first;
+  });
+
+  // Owner of identical replacements made by several transforms. Any other
+  // replacement overlapping them conflicts with one of these transforms.
+  const unsigned SharedOwner = ~0u;
+  // The replacement ending the furthest in the current file, and the one
+  // ending the furthest among those with another owner.
+  struct Extent {
+    unsigned End;
+    unsigned Owner;
+  } Furthest = { 0, SharedOwner }, OtherFurthest = { 0, SharedOwner };
+  // The owner of the replacements at the start offset of the previous one.
+  unsigned OffsetOwner = SharedOwner;
+  const Replacement *Prev = nullptr;
+
+  for (unsigned I = 0, E = All.size(); I != E;) {
+    const Replacement &R = *All[I].first;
+    unsigned Owner = All[I].second;
+    for (++I; I != E && *All[I].first == R; ++I)
+      if (All[I].second != Owner)
+        Owner = SharedOwner;
+
+    unsigned Offset = R.getOffset(), End = Offset + R.getLength();
+    bool NewFile = !Prev || Prev->getFilePath() != R.getFilePath();
+    if (NewFile) {
+      Furthest.End = OtherFurthest.End = 0;
+      Furthest.Owner = OtherFurthest.Owner = SharedOwner;
+    } else {
+      // Replacements of the same owner never conflict, shared ones conflict
+      // with everything.
+      const Extent &Other = Owner == Furthest.Owner && Owner != SharedOwner
+                                ? OtherFurthest
+                                : Furthest;
+      if (Other.End > Offset)
+        return true;
+      if (Offset == Prev->getOffset() &&
+          (Owner != OffsetOwner || Owner == SharedOwner))
+        return true;
+    }
+
+    if (NewFile || Offset != Prev->getOffset())
+      OffsetOwner = Owner;
+    if (End > Furthest.End) {
+      if (Owner != Furthest.Owner)
+        OtherFurthest = Furthest;
+      Furthest.End = End;
+      Furthest.Owner = Owner;
+    } else if (Owner != Furthest.Owner && End > OtherFurthest.End) {
+      OtherFurthest.End = End;
+      OtherFurthest.Owner = Owner;
+    }
+    Prev = &R;
+  }
+  return false;
+}
 } // namespace
 
 Transform::Transform(llvm::StringRef Name, const TransformOptions &Options)
@@ -84,6 +314,28 @@ Transform::Transform(llvm::StringRef Name, const TransformOptions &Options)
 
 Transform::~Transform() {}
 
+int Transform::apply(const CompilationDatabase &Database,
+                     const std::vector<std::string> &SourcePaths) {
+  unsigned NumThreads = getNumThreads(GlobalOptions, SourcePaths.size());
+  if (NumThreads > 1) {
+    int Result = applyInParallel(this, Database, SourcePaths, NumThreads);
+    if (Result >= 0)
+      return Result;
+  }
+
+  ClangTool Tool(Database, SourcePaths);
+  MatchFinder Finder;
+
+  Reset();
+  registerMatchers(Finder);
+
+  if (int Result = Tool.run(createActionFactory(Finder).get())) {
+    llvm::errs() << "Error encountered during translation.\n";
+    return Result;
+  }
+  return 0;
+}
+
 bool Transform::isFileModifiable(const SourceManager &SM,
                                  const SourceLocation &Loc) const {
   if (SM.isWrittenInMainFile(Loc))
@@ -98,6 +350,9 @@ bool Transform::isFileModifiable(const SourceManager &SM,
 
 bool Transform::handleBeginSource(CompilerInstance &CI, StringRef Filename) {
   CurrentSource = Filename;
+  CurrentSourceStart.Accepted = AcceptedChanges;
+  CurrentSourceStart.Rejected = RejectedChanges;
+  CurrentSourceStart.Deferred = DeferredChanges;
 
   if (Options().EnableTiming) {
     Timings.push_back(std::make_pair(Filename.str(), llvm::TimeRecord()));
@@ -107,6 +362,10 @@ bool Transform::handleBeginSource(CompilerInstance &CI, StringRef Filename) {
 }
 
 void Transform::handleEndSource() {
+  ChangeCounts &Changes = TUChanges[CurrentSource];
+  Changes.Accepted += AcceptedChanges - CurrentSourceStart.Accepted;
+  Changes.Rejected += RejectedChanges - CurrentSourceStart.Rejected;
+  Changes.Deferred += DeferredChanges - CurrentSourceStart.Deferred;
   CurrentSource.clear();
   if (Options().EnableTiming)
     Timings.back().second += llvm::TimeRecord::getCurrentTime(false);
@@ -116,6 +375,39 @@ void Transform::addTiming(llvm::StringRef Label, llvm::TimeRecord Duration) {
   Timings.push_back(std::make_pair(Label.str(), Duration));
 }
 
+void Transform::mergeShard(const Transform &Shard) {
+  for (const auto &Entry : Shard.Replacements) {
+    const TranslationUnitReplacements &ShardTU = Entry.getValue();
+    TranslationUnitReplacements &TU = Replacements[Entry.getKey()];
+    if (TU.MainSourceFile.empty())
+      TU.MainSourceFile = ShardTU.MainSourceFile;
+    TU.Replacements.insert(TU.Replacements.end(), ShardTU.Replacements.begin(),
+                           ShardTU.Replacements.end());
+  }
+
+  AcceptedChanges += Shard.AcceptedChanges;
+  RejectedChanges += Shard.RejectedChanges;
+  DeferredChanges += Shard.DeferredChanges;
+  for (const auto &Entry : Shard.TUChanges) {
+    ChangeCounts &Changes = TUChanges[Entry.getKey()];
+    Changes.Accepted += Entry.getValue().Accepted;
+    Changes.Rejected += Entry.getValue().Rejected;
+    Changes.Deferred += Entry.getValue().Deferred;
+  }
+  Timings.insert(Timings.end(), Shard.Timings.begin(), Shard.Timings.end());
+}
+
+void Transform::discardTranslationUnit(StringRef SourcePath) {
+  Replacements.erase(SourcePath);
+  auto I = TUChanges.find(SourcePath);
+  if (I == TUChanges.end())
+    return;
+  AcceptedChanges -= I->getValue().Accepted;
+  RejectedChanges -= I->getValue().Rejected;
+  DeferredChanges -= I->getValue().Deferred;
+  TUChanges.erase(I);
+}
+
 bool
 Transform::addReplacementForCurrentTU(const clang::tooling::Replacement &R) {
   if (CurrentSource.empty())
@@ -131,7 +423,52 @@ Transform::addReplacementForCurrentTU(const clang::tooling::Replacement &R) {
 
 std::unique_ptr<FrontendActionFactory>
 Transform::createActionFactory(MatchFinder &Finder) {
-  return llvm::make_unique<ActionFactory>(Finder, /*Owner=*/*this);
+  Transform *Owner = this;
+  return llvm::make_unique<ActionFactory>(Finder, Owner);
+}
+
+int applyTransformsWithSingleParse(
+    llvm::ArrayRef<Transform *> Transforms, const CompilationDatabase &Database,
+    const std::vector<std::string> &SourcePaths,
+    std::vector<std::string> &ConflictingSources) {
+  if (Transforms.empty())
+    return 0;
+
+  int Result = -1;
+  unsigned NumThreads =
+      getNumThreads(Transforms.front()->getOptions(), SourcePaths.size());
+  if (NumThreads > 1)
+    Result = applyInParallel(Transforms, Database, SourcePaths, NumThreads);
+
+  if (Result < 0) {
+    ClangTool Tool(Database, SourcePaths);
+    MatchFinder Finder;
+
+    for (Transform *T : Transforms) {
+      T->Reset();
+      T->registerMatchers(Finder);
+    }
+
+    ActionFactory Factory(Finder, Transforms);
+    Result = Tool.run(&Factory);
+    if (Result)
+      llvm::errs() << "Error encountered during translation.\n";
+  }
+  if (Result)
+    return Result;
+
+  std::set<std::string> Sources;
+  for (Transform *T : Transforms)
+    for (const auto &Entry : T->getAllReplacements())
+      Sources.insert(Entry.getKey());
+  for (const std::string &Source : Sources) {
+    if (!haveOverlappingReplacements(Transforms, Source))
+      continue;
+    for (Transform *T : Transforms)
+      T->discardTranslationUnit(Source);
+    ConflictingSources.push_back(Source);
+  }
+  return 0;
 }
 
 Version Version::getFromString(llvm::StringRef VersionStr) {
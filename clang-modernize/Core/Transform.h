@@ -18,6 +18,8 @@
 
 #include "Core/IncludeExcludeInfo.h"
 #include "Core/Refactoring.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Registry.h"
 #include "llvm/Support/Timer.h"
@@ -68,13 +70,18 @@ struct TransformOptions {
 
   /// \brief Maximum allowed level of risk.
   RiskLevel MaxRiskLevel;
+
+  /// \brief Number of translation units to process in parallel. 0 means the
+  /// number of hardware threads.
+  unsigned NumThreads;
 };
 
 /// \brief Abstract base class for all C++11 migration transforms.
 ///
-/// Subclasses must call createActionFactory() to create a
-/// FrontendActionFactory to pass to ClangTool::run(). Subclasses are also
-/// responsible for calling setOverrides() before calling ClangTool::run().
+/// Subclasses register their matchers and callbacks in registerMatchers(). The
+/// default implementation of apply() runs them on all sources with a
+/// \c ClangTool. Subclasses overriding apply() must call createActionFactory()
+/// to create a FrontendActionFactory to pass to ClangTool::run().
 ///
 /// If timing is enabled (see TransformOptions), per-source performance timing
 /// is recorded and stored in a TimingVec for later access with timing_begin()
@@ -91,6 +98,11 @@ public:
 
   /// \brief Apply a transform to all files listed in \p SourcePaths.
   ///
+  /// The default implementation parses all sources running the matchers added
+  /// by registerMatchers(). If \c TransformOptions::NumThreads allows it and
+  /// the transform supports createShard(), the sources are processed by a pool
+  /// of worker threads, each running its own shard of the transform.
+  ///
   /// \param[in] Database Contains information for how to compile all files in
   /// \p SourcePaths.
   /// \param[in] SourcePaths list of sources to transform.
@@ -98,7 +110,36 @@ public:
   /// \returns \li 0 if successful
   ///          \li 1 otherwise
   virtual int apply(const clang::tooling::CompilationDatabase &Database,
-                    const std::vector<std::string> &SourcePaths) = 0;
+                    const std::vector<std::string> &SourcePaths);
+
+  /// \brief Adds the matchers of this transform to \p Finder.
+  ///
+  /// The callbacks are owned by the transform and stay valid until the next
+  /// call to registerMatchers(). They record the changes they make in the
+  /// counters of this transform, which should be reset before.
+  virtual void registerMatchers(clang::ast_matchers::MatchFinder &Finder) {}
+
+  /// \brief Creates a new instance of this transform with the same options.
+  ///
+  /// Parallel apply() runs one shard per worker thread, so that callbacks,
+  /// per-TU state, replacements and change counters are never shared between
+  /// threads. The results are merged back with mergeShard().
+  ///
+  /// \returns The new shard, owned by the caller, or nullptr if the transform
+  /// can only be applied serially.
+  virtual Transform *createShard() { return nullptr; }
+
+  /// \brief Adds the replacements, change counters and timings collected by
+  /// \p Shard to this transform.
+  ///
+  /// \pre \p Shard didn't process any translation unit processed by this
+  /// transform.
+  void mergeShard(const Transform &Shard);
+
+  /// \brief Forgets the replacements recorded for the translation unit of
+  /// \p SourcePath and the changes counted while processing it, e.g. to
+  /// transform it again.
+  void discardTranslationUnit(llvm::StringRef SourcePath);
 
   /// \brief Query if changes were made during the last call to apply().
   bool getChangesMade() const { return AcceptedChanges > 0; }
@@ -121,6 +162,9 @@ public:
   /// \brief Query transform name.
   llvm::StringRef getName() const { return Name; }
 
+  /// \brief Query the options the transform was created with.
+  const TransformOptions &getOptions() const { return GlobalOptions; }
+
   /// \brief Reset internal state of the transform.
   ///
   /// Useful if calling apply() several times with one instantiation of a
@@ -129,6 +173,7 @@ public:
     AcceptedChanges = 0;
     RejectedChanges = 0;
     DeferredChanges = 0;
+    TUChanges.clear();
   }
 
   /// \brief Tests if the file containing \a Loc is allowed to be modified by
@@ -211,6 +256,12 @@ protected:
   std::unique_ptr<clang::tooling::FrontendActionFactory>
   createActionFactory(clang::ast_matchers::MatchFinder &Finder);
 
+  /// \brief Provide the change counters to the callbacks added in
+  /// registerMatchers(), which update them as they make changes.
+  unsigned &acceptedChanges() { return AcceptedChanges; }
+  unsigned &rejectedChanges() { return RejectedChanges; }
+  unsigned &deferredChanges() { return DeferredChanges; }
+
 private:
   const std::string Name;
   const TransformOptions &GlobalOptions;
@@ -220,8 +271,43 @@ private:
   unsigned AcceptedChanges;
   unsigned RejectedChanges;
   unsigned DeferredChanges;
+
+  /// \brief Changes counted while processing a translation unit.
+  struct ChangeCounts {
+    ChangeCounts() : Accepted(0), Rejected(0), Deferred(0) {}
+    unsigned Accepted;
+    unsigned Rejected;
+    unsigned Deferred;
+  };
+  /// \brief Changes counted for each translation unit, so that they can be
+  /// discarded with it.
+  llvm::StringMap<ChangeCounts> TUChanges;
+  /// \brief The counters when the current translation unit was started.
+  ChangeCounts CurrentSourceStart;
 };
 
+/// \brief Applies all \p Transforms to the files listed in \p SourcePaths,
+/// parsing each translation unit only once.
+///
+/// The matchers of all transforms are run together on the same AST. Each
+/// transform still records its own replacements and change counters, but all
+/// replacements refer to the original sources, so they must be applied
+/// together rather than one transform after the other.
+///
+/// Replacements of different transforms that overlap can't be applied
+/// together. The results of the translation units where this happens are
+/// discarded from all \p Transforms, and their paths are added to
+/// \p ConflictingSources so that they can be transformed one transform at a
+/// time instead.
+///
+/// \returns \li 0 if successful
+///          \li 1 otherwise
+int applyTransformsWithSingleParse(
+    llvm::ArrayRef<Transform *> Transforms,
+    const clang::tooling::CompilationDatabase &Database,
+    const std::vector<std::string> &SourcePaths,
+    std::vector<std::string> &ConflictingSources);
+
 /// \brief Describes a version number of the form major[.minor] (minor being
 /// optional).
 struct Version {
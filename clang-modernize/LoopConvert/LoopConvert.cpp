@@ -24,40 +24,23 @@ using clang::ast_matchers::MatchFinder;
 using namespace clang::tooling;
 using namespace clang;
 
-int LoopConvertTransform::apply(const CompilationDatabase &Database,
-                                const std::vector<std::string> &SourcePaths) {
-  ClangTool LoopTool(Database, SourcePaths);
-
-  unsigned AcceptedChanges = 0;
-  unsigned DeferredChanges = 0;
-  unsigned RejectedChanges = 0;
-
+void LoopConvertTransform::registerMatchers(MatchFinder &Finder) {
   TUInfo.reset(new TUTrackingInfo);
 
-  MatchFinder Finder;
-  LoopFixer ArrayLoopFixer(*TUInfo, &AcceptedChanges, &DeferredChanges,
-                           &RejectedChanges, Options().MaxRiskLevel, LFK_Array,
-                           /*Owner=*/ *this);
-  Finder.addMatcher(makeArrayLoopMatcher(), &ArrayLoopFixer);
-  LoopFixer IteratorLoopFixer(*TUInfo, &AcceptedChanges, &DeferredChanges,
-                              &RejectedChanges, Options().MaxRiskLevel,
-                              LFK_Iterator, /*Owner=*/ *this);
-  Finder.addMatcher(makeIteratorLoopMatcher(), &IteratorLoopFixer);
-  LoopFixer PseudoarrrayLoopFixer(*TUInfo, &AcceptedChanges, &DeferredChanges,
-                                  &RejectedChanges, Options().MaxRiskLevel,
-                                  LFK_PseudoArray, /*Owner=*/ *this);
-  Finder.addMatcher(makePseudoArrayLoopMatcher(), &PseudoarrrayLoopFixer);
-
-  if (int result = LoopTool.run(createActionFactory(Finder).get())) {
-    llvm::errs() << "Error encountered during translation.\n";
-    return result;
-  }
-
-  setAcceptedChanges(AcceptedChanges);
-  setRejectedChanges(RejectedChanges);
-  setDeferredChanges(DeferredChanges);
-
-  return 0;
+  ArrayLoopFixer.reset(new LoopFixer(*TUInfo, &acceptedChanges(),
+                                     &deferredChanges(), &rejectedChanges(),
+                                     Options().MaxRiskLevel, LFK_Array,
+                                     /*Owner=*/ *this));
+  Finder.addMatcher(makeArrayLoopMatcher(), ArrayLoopFixer.get());
+  IteratorLoopFixer.reset(new LoopFixer(*TUInfo, &acceptedChanges(),
+                                        &deferredChanges(), &rejectedChanges(),
+                                        Options().MaxRiskLevel, LFK_Iterator,
+                                        /*Owner=*/ *this));
+  Finder.addMatcher(makeIteratorLoopMatcher(), IteratorLoopFixer.get());
+  PseudoarrayLoopFixer.reset(new LoopFixer(
+      *TUInfo, &acceptedChanges(), &deferredChanges(), &rejectedChanges(),
+      Options().MaxRiskLevel, LFK_PseudoArray, /*Owner=*/ *this));
+  Finder.addMatcher(makePseudoArrayLoopMatcher(), PseudoarrayLoopFixer.get());
 }
 
 bool
@@ -22,6 +22,7 @@
 
 // Forward decl for private implementation.
 struct TUTrackingInfo;
+class LoopFixer;
 
 /// \brief Subclass of Transform that transforms for-loops into range-based
 /// for-loops where possible.
@@ -30,14 +31,22 @@ public:
   LoopConvertTransform(const TransformOptions &Options)
       : Transform("LoopConvert", Options) {}
 
-  /// \see Transform::run().
-  virtual int apply(const clang::tooling::CompilationDatabase &Database,
-                    const std::vector<std::string> &SourcePaths) override;
+  /// \see Transform::registerMatchers().
+  virtual void
+  registerMatchers(clang::ast_matchers::MatchFinder &Finder) override;
+
+  /// \see Transform::createShard().
+  virtual Transform *createShard() override {
+    return new LoopConvertTransform(Options());
+  }
 
   virtual bool handleBeginSource(clang::CompilerInstance &CI,
                                  llvm::StringRef Filename) override;
 private:
   std::unique_ptr<TUTrackingInfo> TUInfo;
+  std::unique_ptr<LoopFixer> ArrayLoopFixer;
+  std::unique_ptr<LoopFixer> IteratorLoopFixer;
+  std::unique_ptr<LoopFixer> PseudoarrayLoopFixer;
 };
 
 #endif // CLANG_MODERNIZE_LOOP_CONVERT_H
@@ -21,28 +21,12 @@ using namespace clang;
 using namespace clang::tooling;
 using namespace clang::ast_matchers;
 
-int PassByValueTransform::apply(const tooling::CompilationDatabase &Database,
-                                const std::vector<std::string> &SourcePaths) {
-  ClangTool Tool(Database, SourcePaths);
-  unsigned AcceptedChanges = 0;
-  unsigned RejectedChanges = 0;
-  MatchFinder Finder;
-  ConstructorParamReplacer Replacer(AcceptedChanges, RejectedChanges,
-                                    /*Owner=*/ *this);
+void PassByValueTransform::registerMatchers(MatchFinder &Finder) {
+  // The replacer is also used by handleBeginSource().
+  Replacer.reset(new ConstructorParamReplacer(
+      acceptedChanges(), rejectedChanges(), /*Owner=*/ *this));
 
-  Finder.addMatcher(makePassByValueCtorParamMatcher(), &Replacer);
-
-  // make the replacer available to handleBeginSource()
-  this->Replacer = &Replacer;
-
-  if (Tool.run(createActionFactory(Finder).get())) {
-    llvm::errs() << "Error encountered during translation.\n";
-    return 1;
-  }
-
-  setAcceptedChanges(AcceptedChanges);
-  setRejectedChanges(RejectedChanges);
-  return 0;
+  Finder.addMatcher(makePassByValueCtorParamMatcher(), Replacer.get());
 }
 
 bool PassByValueTransform::handleBeginSource(CompilerInstance &CI,
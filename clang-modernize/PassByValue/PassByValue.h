@@ -55,11 +55,16 @@ class ConstructorParamReplacer;
 class PassByValueTransform : public Transform {
 public:
   PassByValueTransform(const TransformOptions &Options)
-      : Transform("PassByValue", Options), Replacer(nullptr) {}
+      : Transform("PassByValue", Options) {}
 
-  /// \see Transform::apply().
-  virtual int apply(const clang::tooling::CompilationDatabase &Database,
-                    const std::vector<std::string> &SourcePaths) override;
+  /// \see Transform::registerMatchers().
+  virtual void
+  registerMatchers(clang::ast_matchers::MatchFinder &Finder) override;
+
+  /// \see Transform::createShard().
+  virtual Transform *createShard() override {
+    return new PassByValueTransform(Options());
+  }
 
 private:
   /// \brief Setups the \c IncludeDirectives for the replacer.
@@ -67,7 +72,7 @@ private:
                                  llvm::StringRef Filename) override;
 
   std::unique_ptr<IncludeDirectives> IncludeManager;
-  ConstructorParamReplacer *Replacer;
+  std::unique_ptr<ConstructorParamReplacer> Replacer;
 };
 
 #endif // CLANG_MODERNIZE_PASS_BY_VALUE_H
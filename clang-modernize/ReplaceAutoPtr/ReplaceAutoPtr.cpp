@@ -21,27 +21,13 @@ using namespace clang;
 using namespace clang::tooling;
 using namespace clang::ast_matchers;
 
-int
-ReplaceAutoPtrTransform::apply(const CompilationDatabase &Database,
-                               const std::vector<std::string> &SourcePaths) {
-  ClangTool Tool(Database, SourcePaths);
-  unsigned AcceptedChanges = 0;
-  MatchFinder Finder;
-  AutoPtrReplacer Replacer(AcceptedChanges, /*Owner=*/ *this);
-  OwnershipTransferFixer Fixer(AcceptedChanges, /*Owner=*/ *this);
+void ReplaceAutoPtrTransform::registerMatchers(MatchFinder &Finder) {
+  Replacer.reset(new AutoPtrReplacer(acceptedChanges(), /*Owner=*/ *this));
+  Fixer.reset(new OwnershipTransferFixer(acceptedChanges(), /*Owner=*/ *this));
 
-  Finder.addMatcher(makeAutoPtrTypeLocMatcher(), &Replacer);
-  Finder.addMatcher(makeAutoPtrUsingDeclMatcher(), &Replacer);
-  Finder.addMatcher(makeTransferOwnershipExprMatcher(), &Fixer);
-
-  if (Tool.run(createActionFactory(Finder).get())) {
-    llvm::errs() << "Error encountered during translation.\n";
-    return 1;
-  }
-
-  setAcceptedChanges(AcceptedChanges);
-
-  return 0;
+  Finder.addMatcher(makeAutoPtrTypeLocMatcher(), Replacer.get());
+  Finder.addMatcher(makeAutoPtrUsingDeclMatcher(), Replacer.get());
+  Finder.addMatcher(makeTransferOwnershipExprMatcher(), Fixer.get());
 }
 
 struct ReplaceAutoPtrFactory : TransformFactory {
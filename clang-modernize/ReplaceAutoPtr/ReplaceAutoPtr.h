@@ -19,6 +19,9 @@
 #include "Core/Transform.h"
 #include "llvm/Support/Compiler.h"
 
+class AutoPtrReplacer;
+class OwnershipTransferFixer;
+
 /// \brief Subclass of Transform that transforms the deprecated \c std::auto_ptr
 /// into the C++11 \c std::unique_ptr.
 ///
@@ -46,9 +49,18 @@ public:
   ReplaceAutoPtrTransform(const TransformOptions &Options)
       : Transform("ReplaceAutoPtr", Options) {}
 
-  /// \see Transform::run().
-  virtual int apply(const clang::tooling::CompilationDatabase &Database,
-                    const std::vector<std::string> &SourcePaths) override;
+  /// \see Transform::registerMatchers().
+  virtual void
+  registerMatchers(clang::ast_matchers::MatchFinder &Finder) override;
+
+  /// \see Transform::createShard().
+  virtual Transform *createShard() override {
+    return new ReplaceAutoPtrTransform(Options());
+  }
+
+private:
+  std::unique_ptr<AutoPtrReplacer> Replacer;
+  std::unique_ptr<OwnershipTransferFixer> Fixer;
 };
 
 #endif // CLANG_MODERNIZE_REPLACE_AUTO_PTR_H
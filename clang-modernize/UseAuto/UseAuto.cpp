@@ -20,30 +20,14 @@ using clang::ast_matchers::MatchFinder;
 using namespace clang;
 using namespace clang::tooling;
 
-int UseAutoTransform::apply(const clang::tooling::CompilationDatabase &Database,
-                            const std::vector<std::string> &SourcePaths) {
-  ClangTool UseAutoTool(Database, SourcePaths);
-
-  unsigned AcceptedChanges = 0;
-
-  MatchFinder Finder;
-  ReplacementsVec Replaces;
-  IteratorReplacer ReplaceIterators(AcceptedChanges, Options().MaxRiskLevel,
-                                    /*Owner=*/ *this);
-  NewReplacer ReplaceNew(AcceptedChanges, Options().MaxRiskLevel,
-                         /*Owner=*/ *this);
-
-  Finder.addMatcher(makeIteratorDeclMatcher(), &ReplaceIterators);
-  Finder.addMatcher(makeDeclWithNewMatcher(), &ReplaceNew);
-
-  if (int Result = UseAutoTool.run(createActionFactory(Finder).get())) {
-    llvm::errs() << "Error encountered during translation.\n";
-    return Result;
-  }
-
-  setAcceptedChanges(AcceptedChanges);
-
-  return 0;
+void UseAutoTransform::registerMatchers(MatchFinder &Finder) {
+  ReplaceIterators.reset(new IteratorReplacer(
+      acceptedChanges(), Options().MaxRiskLevel, /*Owner=*/ *this));
+  ReplaceNew.reset(new NewReplacer(acceptedChanges(), Options().MaxRiskLevel,
+                                   /*Owner=*/ *this));
+
+  Finder.addMatcher(makeIteratorDeclMatcher(), ReplaceIterators.get());
+  Finder.addMatcher(makeDeclWithNewMatcher(), ReplaceNew.get());
 }
 
 struct UseAutoFactory : TransformFactory {
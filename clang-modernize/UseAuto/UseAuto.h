@@ -21,6 +21,9 @@
 #include "Core/Transform.h"
 #include "llvm/Support/Compiler.h"
 
+class IteratorReplacer;
+class NewReplacer;
+
 /// \brief Subclass of Transform that transforms type specifiers for variable
 /// declarations into the special C++11 'auto' type specifier for certain cases:
 /// * Iterators of std containers.
@@ -33,9 +36,18 @@ public:
   UseAutoTransform(const TransformOptions &Options)
       : Transform("UseAuto", Options) {}
 
-  /// \see Transform::run().
-  virtual int apply(const clang::tooling::CompilationDatabase &Database,
-                    const std::vector<std::string> &SourcePaths) override;
+  /// \see Transform::registerMatchers().
+  virtual void
+  registerMatchers(clang::ast_matchers::MatchFinder &Finder) override;
+
+  /// \see Transform::createShard().
+  virtual Transform *createShard() override {
+    return new UseAutoTransform(Options());
+  }
+
+private:
+  std::unique_ptr<IteratorReplacer> ReplaceIterators;
+  std::unique_ptr<NewReplacer> ReplaceNew;
 };
 
 #endif // CLANG_MODERNIZE_USE_AUTO_H
@@ -31,29 +31,16 @@ UserNullMacroNames("user-null-macros",
                             "macro names that behave like NULL"),
                    cl::cat(TransformsOptionsCategory), cl::init(""));
 
-int UseNullptrTransform::apply(const CompilationDatabase &Database,
-                               const std::vector<std::string> &SourcePaths) {
-  ClangTool UseNullptrTool(Database, SourcePaths);
-
-  unsigned AcceptedChanges = 0;
-
+void UseNullptrTransform::registerMatchers(MatchFinder &Finder) {
   llvm::SmallVector<llvm::StringRef, 1> MacroNames;
   if (!UserNullMacroNames.empty()) {
     llvm::StringRef S = UserNullMacroNames;
     S.split(MacroNames, ",");
   }
-  MatchFinder Finder;
-  NullptrFixer Fixer(AcceptedChanges, MacroNames, /*Owner=*/ *this);
-
-  Finder.addMatcher(makeCastSequenceMatcher(), &Fixer);
-  if (int result = UseNullptrTool.run(createActionFactory(Finder).get())) {
-    llvm::errs() << "Error encountered during translation.\n";
-    return result;
-  }
-
-  setAcceptedChanges(AcceptedChanges);
+  Fixer.reset(
+      new NullptrFixer(acceptedChanges(), MacroNames, /*Owner=*/ *this));
 
-  return 0;
+  Finder.addMatcher(makeCastSequenceMatcher(), Fixer.get());
 }
 
 struct UseNullptrFactory : TransformFactory {
@@ -20,6 +20,8 @@
 #include "Core/Transform.h"
 #include "llvm/Support/Compiler.h" // For override
 
+class NullptrFixer;
+
 /// \brief Subclass of Transform that transforms null pointer constants into
 /// C++11's nullptr keyword where possible.
 class UseNullptrTransform : public Transform {
@@ -27,9 +29,17 @@ public:
   UseNullptrTransform(const TransformOptions &Options)
       : Transform("UseNullptr", Options) {}
 
-  /// \see Transform::run().
-  virtual int apply(const clang::tooling::CompilationDatabase &Database,
-                    const std::vector<std::string> &SourcePaths) override;
+  /// \see Transform::registerMatchers().
+  virtual void
+  registerMatchers(clang::ast_matchers::MatchFinder &Finder) override;
+
+  /// \see Transform::createShard().
+  virtual Transform *createShard() override {
+    return new UseNullptrTransform(Options());
+  }
+
+private:
+  std::unique_ptr<NullptrFixer> Fixer;
 };
 
 #endif // CLANG_MODERNIZE_USE_NULLPTR_H
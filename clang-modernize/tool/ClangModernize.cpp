@@ -97,11 +97,26 @@ static cl::opt<RiskLevel, /*ExternalStorage=*/true> MaxRiskLevel(
     cl::location(GlobalOptions.MaxRiskLevel), cl::init(RL_Reasonable),
     cl::cat(GeneralCategory));
 
+static cl::opt<unsigned, /*ExternalStorage=*/true> NumThreads(
+    "j",
+    cl::desc("Number of translation units to process in parallel.\n"
+             "0 means the number of hardware threads."),
+    cl::location(GlobalOptions.NumThreads), cl::init(1), cl::value_desc("N"),
+    cl::cat(GeneralCategory));
+
 static cl::opt<bool> FinalSyntaxCheck(
     "final-syntax-check",
     cl::desc("Check for correct syntax after applying transformations"),
     cl::init(false), cl::cat(GeneralCategory));
 
+static cl::opt<bool> SingleParse(
+    "single-parse",
+    cl::desc("Parse each translation unit only once and run all selected\n"
+             "transforms on it. Changes from all transforms are applied\n"
+             "together. Sources where they overlap are transformed\n"
+             "again one transform at a time."),
+    cl::init(false), cl::cat(GeneralCategory));
+
 static cl::opt<bool> SummaryMode("summary", cl::desc("Print transform summary"),
                                  cl::init(false), cl::cat(GeneralCategory));
 
@@ -187,6 +202,12 @@ SerializeLocation("serialize-dir",
                            "write to a temporary directory.\n"),
                   cl::cat(SerializeCategory));
 
+static cl::opt<bool>
+SerializeBinary("serialize-binary",
+                cl::desc("Serialize replacements in a compact binary format\n"
+                         "instead of YAML."),
+                cl::init(false), cl::cat(SerializeCategory));
+
 ////////////////////////////////////////////////////////////////////////////////
 
 void printVersion() {
@@ -402,9 +423,11 @@ int main(int argc, const char **argv) {
   // GlobalOptions.
 
   // If SerializeReplacements is requested, then code reformatting must be
-  // turned off and only one transform should be requested.
+  // turned off and only one transform should be requested, unless all
+  // transforms are run on the same parse.
   if (SerializeOnly &&
-      (std::distance(TransformManager.begin(), TransformManager.end()) > 1 ||
+      ((std::distance(TransformManager.begin(), TransformManager.end()) > 1 &&
+        !SingleParse) ||
        DoFormat)) {
     llvm::errs() << "Serialization of replacements requested for multiple "
                     "transforms.\nChanges from only one transform can be "
@@ -412,36 +435,103 @@ int main(int argc, const char **argv) {
     return 1;
   }
 
-  // If we're asked to apply changes to files on disk, need to locate
-  // clang-apply-replacements.
-  if (!SerializeOnly) {
-    if (!ReplacementHandler.findClangApplyReplacements(argv[0])) {
-      llvm::errs() << "Could not find clang-apply-replacements\n";
+  if (!SerializeOnly && DoFormat)
+    ReplacementHandler.enableFormatting(FormatStyleOpt, FormatStyleConfig);
+
+  // Replacements are only written to disk when serialization is requested,
+  // otherwise they are applied in memory.
+  StringRef TempDestinationDir;
+  if (SerializeOnly) {
+    if (SerializeLocation.getNumOccurrences() > 0)
+      ReplacementHandler.setDestinationDir(SerializeLocation);
+    else
+      TempDestinationDir = ReplacementHandler.useTempDestinationDir();
+    if (SerializeBinary)
+      ReplacementHandler.enableBinaryFormat();
+  }
+
+  SourcePerfData PerfData;
+
+  // With -single-parse all replacements refer to the original sources, so they
+  // are applied together. The sources where replacements of different
+  // transforms overlap are transformed again below, one transform at a time.
+  std::vector<std::string> SequentialSources;
+  if (SingleParse) {
+    std::vector<Transform *> SelectedTransforms(TransformManager.begin(),
+                                                TransformManager.end());
+    if (applyTransformsWithSingleParse(SelectedTransforms, *Compilations,
+                                       Sources, SequentialSources) != 0)
       return 1;
+
+    if (!SequentialSources.empty()) {
+      if (SerializeOnly) {
+        llvm::errs() << "Replacements of different transforms overlap in "
+                     << SequentialSources.front()
+                     << ".\nThey can't be serialized together, run the "
+                        "transforms separately.\n";
+        return 1;
+      }
+      llvm::errs() << "Replacements of different transforms overlap in "
+                   << SequentialSources.size()
+                   << " source(s), which are transformed again one transform "
+                      "at a time.\n";
     }
 
-    if (DoFormat)
-      ReplacementHandler.enableFormatting(FormatStyleOpt, FormatStyleConfig);
+    for (Transform *T : TransformManager) {
+      if (SerializeOnly) {
+        if (!ReplacementHandler.serializeReplacements(T->getAllReplacements()))
+          return 1;
+        continue;
+      }
+      ReplacementHandler.addReplacements(T->getAllReplacements());
+    }
+    if (!SerializeOnly && !ReplacementHandler.applyReplacements())
+      return 1;
+  } else {
+    SequentialSources = Sources;
   }
 
-  StringRef TempDestinationDir;
-  if (SerializeLocation.getNumOccurrences() > 0)
-    ReplacementHandler.setDestinationDir(SerializeLocation);
-  else
-    TempDestinationDir = ReplacementHandler.useTempDestinationDir();
+  if (!SequentialSources.empty()) {
+    for (Transform *T : TransformManager) {
+      // After a single parse, a new instance of the transform handles the
+      // remaining sources and its results are merged into T.
+      std::unique_ptr<Transform> Shard;
+      Transform *Runner = T;
+      if (SingleParse) {
+        Shard.reset(T->createShard());
+        if (!Shard) {
+          llvm::errs() << "Transform " << T->getName()
+                       << " can't be applied again.\n";
+          return 1;
+        }
+        Runner = Shard.get();
+      }
 
-  SourcePerfData PerfData;
+      if (Runner->apply(*Compilations, SequentialSources) != 0) {
+        // FIXME: Improve ClangTool to not abort if just one file fails.
+        return 1;
+      }
+
+      if (SerializeOnly) {
+        if (!ReplacementHandler.serializeReplacements(
+                Runner->getAllReplacements()))
+          return 1;
+      } else {
+        ReplacementHandler.addReplacements(Runner->getAllReplacements());
+        if (!ReplacementHandler.applyReplacements())
+          return 1;
+      }
+
+      if (Shard)
+        T->mergeShard(*Shard);
+    }
+  }
 
   for (Transforms::const_iterator I = TransformManager.begin(),
                                   E = TransformManager.end();
        I != E; ++I) {
     Transform *T = *I;
 
-    if (T->apply(*Compilations, Sources) != 0) {
-      // FIXME: Improve ClangTool to not abort if just one file fails.
-      return 1;
-    }
-
     if (GlobalOptions.EnableTiming)
       collectSourcePerfData(*T, PerfData);
 
@@ -454,13 +544,6 @@ int main(int argc, const char **argv) {
       }
       llvm::outs() << "\n";
     }
-
-    if (!ReplacementHandler.serializeReplacements(T->getAllReplacements()))
-      return 1;
-
-    if (!SerializeOnly)
-      if (!ReplacementHandler.applyReplacements())
-        return 1;
   }
 
   // Let the user know which temporary directory the replacements got written
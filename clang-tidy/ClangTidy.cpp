@@ -16,8 +16,12 @@
 //===----------------------------------------------------------------------===//
 
 #include "ClangTidy.h"
+#include "ClangTidyCache.h"
 #include "ClangTidyDiagnosticConsumer.h"
 #include "ClangTidyModuleRegistry.h"
+#include "ClangTidyPreambleStore.h"
+#include "clang-apply-replacements/Tooling/BinaryReplacements.h"
+#include "clang-apply-replacements/Tooling/WorkingDirectoryInvocation.h"
 #include "clang/AST/ASTConsumer.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/Decl.h"
@@ -30,18 +34,32 @@
 #include "clang/Frontend/TextDiagnosticPrinter.h"
 #include "clang/Lex/PPCallbacks.h"
 #include "clang/Lex/Preprocessor.h"
+#include "clang/Lex/PreprocessorOptions.h"
 #include "clang/Rewrite/Frontend/FixItRewriter.h"
 #include "clang/Rewrite/Frontend/FrontendActions.h"
 #include "clang/StaticAnalyzer/Frontend/AnalysisConsumer.h"
 #include "clang/Tooling/Refactoring.h"
 #include "clang/Tooling/ReplacementsYaml.h"
 #include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Process.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/Threading.h"
 #include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <mutex>
+#include <thread>
 #include <utility>
 
+#ifdef LLVM_ON_UNIX
+#include <sys/resource.h>
+#endif
+
 using namespace clang::ast_matchers;
 using namespace clang::driver;
 using namespace clang::tooling;
@@ -52,6 +70,30 @@ template class llvm::Registry<clang::tidy::ClangTidyModule>;
 namespace clang {
 namespace tidy {
 
+/// \brief The finders the matchers of some of the checks of a
+/// \c ClangTidyCheckSet are registered with.
+struct ClangTidyMatchers {
+  std::unique_ptr<MatchFinder> Finder;
+};
+
+/// \brief The checks of a translation unit and the finders their matchers are
+/// registered with.
+struct ClangTidyCheckSet {
+  ClangTidyCheckSet() : HasPrerequisites(false), Reusable(false) {}
+
+  std::vector<std::unique_ptr<ClangTidyCheck>> Checks;
+  /// \brief The finders by the checks whose matchers they run, see
+  /// \c ClangTidyCheck::getRequiredIdentifiers(). Created when first needed.
+  std::map<std::vector<bool>, ClangTidyMatchers> Matchers;
+  /// \brief Some check requires identifiers.
+  bool HasPrerequisites;
+  /// \brief The matcher times of each check in the last translation unit, if
+  /// profiling.
+  StringMap<TimeRecord> Records;
+  /// \brief All checks are reusable, see \c ClangTidyCheck::isReusable().
+  bool Reusable;
+};
+
 namespace {
 static const char *AnalyzerCheckNamePrefix = "clang-analyzer-";
 
@@ -94,7 +136,7 @@ private:
   ClangTidyContext &Context;
 };
 
-class ErrorReporter {
+class ErrorReporter : public ClangTidyErrorSink {
 public:
   ErrorReporter(bool ApplyFixes)
       : Files(FileSystemOptions()), DiagOpts(new DiagnosticOptions()),
@@ -140,7 +182,15 @@ public:
       reportNote(Note);
   }
 
-  void Finish() {
+  void handleErrors(StringRef /*MainFile*/,
+                    ArrayRef<ClangTidyError> Errors) override {
+    for (const ClangTidyError &Error : Errors)
+      reportDiagnostic(Error);
+  }
+
+  // The fixes of all translation units are applied at the end, as several of
+  // them can change the same header.
+  void finish() override {
     // FIXME: Run clang-format on changes.
     if (ApplyFixes && TotalFixes > 0) {
       llvm::errs() << "clang-tidy applied " << AppliedFixes << " of "
@@ -155,6 +205,8 @@ private:
       return SourceLocation();
 
     const FileEntry *File = SourceMgr.getFileManager().getFile(FilePath);
+    if (!File)
+      return SourceLocation();
     FileID ID = SourceMgr.createFileID(File, SourceLocation(), SrcMgr::C_User);
     return SourceMgr.getLocForStartOfFile(ID).getLocWithOffset(Offset);
   }
@@ -178,19 +230,678 @@ private:
   unsigned AppliedFixes;
 };
 
+/// \brief Writes \p S as a YAML scalar that reads back as \p S.
+///
+/// Like yaml::Output, strings of characters that never need quoting, such as
+/// most paths, are written as they are and the others are single-quoted.
+/// Strings with control characters, e.g. line breaks, are double-quoted with
+/// escapes, as line breaks in single-quoted strings would be folded.
+void writeYAMLString(raw_ostream &OS, StringRef S) {
+  static const char PlainChars[] = "abcdefghijklmnopqrstuvwxyz"
+                                   "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                   "0123456789_-./";
+  if (!S.empty() && S.front() != '-' &&
+      S.find_first_not_of(PlainChars) == StringRef::npos) {
+    OS << S;
+    return;
+  }
+
+  bool HasControlChars = std::any_of(S.begin(), S.end(), [](char C) {
+    return static_cast<unsigned char>(C) < 0x20 || C == 0x7f;
+  });
+  if (!HasControlChars) {
+    OS << '\'';
+    for (char C : S) {
+      if (C == '\'')
+        OS << '\'';
+      OS << C;
+    }
+    OS << '\'';
+    return;
+  }
+
+  OS << '"';
+  for (unsigned char C : S) {
+    if (C == '"' || C == '\\')
+      OS << '\\' << C;
+    else if (C == '\n')
+      OS << "\\n";
+    else if (C == '\t')
+      OS << "\\t";
+    else if (C < 0x20 || C == 0x7f)
+      OS << format("\\x%02x", C);
+    else
+      OS << C;
+  }
+  OS << '"';
+}
+
+/// \brief Writes the fixes of all files as one TranslationUnitReplacements.
+///
+/// The file is only created once there are errors to report. In YAML, each
+/// replacement is written as soon as it is received and the document is
+/// closed in \c finish(). The binary format starts with the number of paths
+/// and replacements, so it is written in \c finish().
+class ReplacementsExporter : public ClangTidyErrorSink {
+public:
+  ReplacementsExporter(StringRef Path, bool Binary, std::error_code &EC)
+      : Path(Path), Binary(Binary), EC(EC), NumWritten(0) {}
+
+  void handleErrors(StringRef /*MainFile*/,
+                    ArrayRef<ClangTidyError> Errors) override {
+    if (Errors.empty() || !open())
+      return;
+    for (const ClangTidyError &Error : Errors) {
+      for (const tooling::Replacement &R : Error.Fix) {
+        if (Binary)
+          Pending.Replacements.push_back(R);
+        else
+          writeYAML(R);
+      }
+    }
+    OS->flush();
+  }
+
+  void finish() override {
+    if (!OS)
+      return;
+    if (Binary) {
+      replace::writeBinaryReplacements(Pending, *OS);
+    } else if (NumWritten == 0) {
+      yaml::Output YAML(*OS);
+      YAML << Pending;
+    } else {
+      *OS << "...\n";
+    }
+    OS->close();
+    if (OS->has_error()) {
+      OS->clear_error();
+      EC = std::make_error_code(std::errc::io_error);
+    }
+    OS.reset();
+  }
+
+private:
+  bool open() {
+    if (OS)
+      return true;
+    if (EC)
+      return false;
+    OS.reset(new llvm::raw_fd_ostream(Path, EC, llvm::sys::fs::F_None));
+    if (EC)
+      OS.reset();
+    return !EC;
+  }
+
+  /// \brief Writes \p R as the next entry of the Replacements sequence, and
+  /// the start of the document before the first one. The layout is the one
+  /// of yaml::Output for a whole TranslationUnitReplacements.
+  void writeYAML(const tooling::Replacement &R) {
+    if (NumWritten++ == 0) {
+      *OS << "---\nMainSourceFile:  ";
+      writeYAMLString(*OS, Pending.MainSourceFile);
+      *OS << "\nReplacements:\n";
+    }
+    *OS << "  - FilePath:        ";
+    writeYAMLString(*OS, R.getFilePath());
+    *OS << "\n    Offset:          " << R.getOffset()
+        << "\n    Length:          " << R.getLength()
+        << "\n    ReplacementText: ";
+    writeYAMLString(*OS, R.getReplacementText());
+    *OS << '\n';
+  }
+
+  std::string Path;
+  bool Binary;
+  std::error_code &EC;
+  std::unique_ptr<llvm::raw_fd_ostream> OS;
+  unsigned NumWritten;
+  tooling::TranslationUnitReplacements Pending;
+};
+
+/// \brief Collects the errors of all translation units.
+class ErrorCollector : public ClangTidyErrorSink {
+public:
+  ErrorCollector(std::vector<ClangTidyError> &Errors) : Errors(Errors) {}
+
+  void handleErrors(StringRef /*MainFile*/,
+                    ArrayRef<ClangTidyError> NewErrors) override {
+    Errors.insert(Errors.end(), NewErrors.begin(), NewErrors.end());
+  }
+
+private:
+  std::vector<ClangTidyError> &Errors;
+};
+
+/// \brief Returns the peak resident set size of the whole process so far in
+/// bytes, or 0 if it isn't known.
+uint64_t getProcessPeakRSS() {
+#ifdef LLVM_ON_UNIX
+  struct rusage Usage;
+  if (getrusage(RUSAGE_SELF, &Usage) != 0)
+    return 0;
+#if defined(__APPLE__)
+  return Usage.ru_maxrss;
+#else
+  return static_cast<uint64_t>(Usage.ru_maxrss) * 1024;
+#endif
+#else
+  return 0;
+#endif
+}
+
+/// \brief Adds the time \c HandleTranslationUnit() of a consumer takes to
+/// \p Time. The other callbacks are forwarded to the consumer untimed.
+class TimedConsumer : public MultiplexConsumer {
+public:
+  TimedConsumer(std::unique_ptr<ASTConsumer> Consumer, TimeRecord &Time)
+      : MultiplexConsumer(makeConsumers(std::move(Consumer))), Time(Time) {}
+
+  void HandleTranslationUnit(ASTContext &Context) override {
+    Time -= TimeRecord::getCurrentTime(/*Start=*/true);
+    MultiplexConsumer::HandleTranslationUnit(Context);
+    Time += TimeRecord::getCurrentTime(/*Start=*/false);
+  }
+
+private:
+  static std::vector<std::unique_ptr<ASTConsumer>>
+  makeConsumers(std::unique_ptr<ASTConsumer> Consumer) {
+    std::vector<std::unique_ptr<ASTConsumer>> Consumers;
+    Consumers.push_back(std::move(Consumer));
+    return Consumers;
+  }
+
+  TimeRecord &Time;
+};
+
 class ClangTidyASTConsumer : public MultiplexConsumer {
 public:
+  /// \brief \p OwnedChecks is null if \p Checks is reused by other
+  /// translation units.
   ClangTidyASTConsumer(std::vector<std::unique_ptr<ASTConsumer>> Consumers,
-                       std::unique_ptr<ast_matchers::MatchFinder> Finder,
-                       std::vector<std::unique_ptr<ClangTidyCheck>> Checks)
-      : MultiplexConsumer(std::move(Consumers)), Finder(std::move(Finder)),
-        Checks(std::move(Checks)) {}
+                       std::unique_ptr<ClangTidyCheckSet> OwnedChecks,
+                       ClangTidyCheckSet &Checks,
+                       std::unique_ptr<TranslationUnitProfile> TUProfile,
+                       ProfileData *Profile)
+      : MultiplexConsumer(std::move(Consumers)),
+        OwnedChecks(std::move(OwnedChecks)), Checks(Checks),
+        TUProfile(std::move(TUProfile)), Profile(Profile) {}
+
+  void HandleTranslationUnit(ASTContext &Context) override {
+    if (!TUProfile) {
+      MultiplexConsumer::HandleTranslationUnit(Context);
+      return;
+    }
+    // The AST is complete, everything since the consumer was created was
+    // spent in the frontend. The matchers and the analyzer are timed by their
+    // TimedConsumers.
+    TUProfile->Parse += TimeRecord::getCurrentTime(/*Start=*/true);
+    MultiplexConsumer::HandleTranslationUnit(Context);
+    TUProfile->ProcessPeakRSSAfter = getProcessPeakRSS();
+    TUProfile->Checks = std::move(Checks.Records);
+    Checks.Records.clear();
+
+    for (const auto &Record : TUProfile->Checks)
+      Profile->Records[Record.getKey()] += Record.getValue();
+    Profile->TranslationUnits.push_back(std::move(*TUProfile));
+    TUProfile.reset();
+  }
 
 private:
-  std::unique_ptr<ast_matchers::MatchFinder> Finder;
-  std::vector<std::unique_ptr<ClangTidyCheck>> Checks;
+  std::unique_ptr<ClangTidyCheckSet> OwnedChecks;
+  ClangTidyCheckSet &Checks;
+  // Set while profiling, until the translation unit is complete.
+  std::unique_ptr<TranslationUnitProfile> TUProfile;
+  ProfileData *Profile;
+};
+
+/// \brief Returns for each of \p Checks whether one of the identifiers it
+/// requires appears in the translation unit of \p ASTCtx.
+std::vector<bool>
+getMetPrerequisites(const std::vector<std::unique_ptr<ClangTidyCheck>> &Checks,
+                    ASTContext &ASTCtx) {
+  std::vector<bool> Met(Checks.size(), true);
+  // The identifiers of a PCH or a module are only loaded when looked up.
+  IdentifierTable &Idents = ASTCtx.Idents;
+  if (Idents.getExternalIdentifierLookup())
+    return Met;
+
+  StringMap<bool> Appears;
+  for (const auto &Check : Checks)
+    for (StringRef Name : Check->getRequiredIdentifiers())
+      Appears[Name] = false;
+  for (const auto &Ident : Idents) {
+    auto I = Appears.find(Ident.getKey());
+    if (I != Appears.end())
+      I->second = true;
+  }
+
+  for (size_t I = 0, E = Checks.size(); I != E; ++I) {
+    std::vector<StringRef> Names = Checks[I]->getRequiredIdentifiers();
+    Met[I] = Names.empty() ||
+             std::any_of(Names.begin(), Names.end(),
+                         [&](StringRef Name) { return Appears[Name]; });
+  }
+  return Met;
+}
+
+/// \brief Returns the finders of the checks of \p Checks for which \p Met is
+/// \c true, registering their matchers on first use.
+ClangTidyMatchers &getMatchers(ClangTidyCheckSet &Checks,
+                               const std::vector<bool> &Met,
+                               ClangTidyContext &Context) {
+  ClangTidyMatchers &Matchers = Checks.Matchers[Met];
+  if (Matchers.Finder)
+    return Matchers;
+
+  ast_matchers::MatchFinder::MatchFinderOptions FinderOptions;
+  if (Context.getCheckProfileData())
+    FinderOptions.CheckProfiling.emplace(Checks.Records);
+  Matchers.Finder.reset(new MatchFinder(std::move(FinderOptions)));
+  for (size_t I = 0, E = Checks.Checks.size(); I != E; ++I)
+    if (Met[I])
+      Checks.Checks[I]->registerMatchers(&*Matchers.Finder);
+  return Matchers;
+}
+
+/// \brief Runs the matchers of the checks of a \c ClangTidyCheckSet that can
+/// find anything in the translation unit.
+///
+/// Which checks these are is only known once the translation unit is parsed,
+/// see \c ClangTidyCheck::getRequiredIdentifiers().
+class CheckSetMatchConsumer : public ASTConsumer {
+public:
+  CheckSetMatchConsumer(ClangTidyCheckSet &Checks, ClangTidyContext &Context)
+      : Checks(Checks), Context(Context) {}
+
+  void HandleTranslationUnit(ASTContext &ASTCtx) override {
+    ClangTidyMatchers &Matchers = getMatchers(
+        Checks, Checks.HasPrerequisites
+                    ? getMetPrerequisites(Checks.Checks, ASTCtx)
+                    : std::vector<bool>(Checks.Checks.size(), true),
+        Context);
+    Matchers.Finder->matchAST(ASTCtx);
+  }
+
+private:
+  ClangTidyCheckSet &Checks;
+  ClangTidyContext &Context;
+};
+
+class ActionFactory : public FrontendActionFactory {
+public:
+  ActionFactory(ClangTidyContext &Context)
+      : ConsumerFactory(Context), ReadFiles(nullptr), Preamble(nullptr),
+        UsesPPCallbacks(nullptr) {}
+  FrontendAction *create() override {
+    return new Action(&ConsumerFactory, ReadFiles, Preamble, UsesPPCallbacks);
+  }
+
+  bool runInvocation(CompilerInvocation *Invocation, FileManager *Files,
+                     DiagnosticConsumer *DiagConsumer) override {
+    if (Preamble) {
+      PreprocessorOptions &PPOpts = Invocation->getPreprocessorOpts();
+      PPOpts.ImplicitPCHInclude = Preamble->PCHPath;
+      PPOpts.addRemappedFile(
+          Preamble->HeaderPath,
+          llvm::MemoryBuffer::getMemBufferCopy(Preamble->HeaderContents)
+              .release());
+      PPOpts.addRemappedFile(
+          Invocation->getFrontendOpts().Inputs[0].getFile(),
+          llvm::MemoryBuffer::getMemBufferCopy(Preamble->MainFileContents)
+              .release());
+    }
+    return FrontendActionFactory::runInvocation(Invocation, Files,
+                                                DiagConsumer);
+  }
+
+  /// \brief Makes the actions created from now on append the absolute paths of
+  /// all files read by their translation unit to \p Files. Recording stops
+  /// if \p Files is null.
+  void recordReadFiles(std::vector<std::string> *Files) { ReadFiles = Files; }
+
+  /// \brief Makes the translation units processed from now on use the PCH of
+  /// \p P instead of parsing its preamble, unless \p P is null.
+  void usePreamble(const ClangTidyPreambleStore::Preamble *P) { Preamble = P; }
+
+  /// \brief Makes the actions created from now on set \p *Result to \c true
+  /// if a check registers \c PPCallbacks. Detection stops if \p Result is
+  /// null.
+  void detectPPCallbacks(bool *Result) { UsesPPCallbacks = Result; }
+
+private:
+  class Action : public ASTFrontendAction {
+  public:
+    Action(ClangTidyASTConsumerFactory *Factory,
+           std::vector<std::string> *ReadFiles,
+           const ClangTidyPreambleStore::Preamble *Preamble,
+           bool *UsesPPCallbacks)
+        : Factory(Factory), ReadFiles(ReadFiles), Preamble(Preamble),
+          UsesPPCallbacks(UsesPPCallbacks) {}
+    std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance &Compiler,
+                                                   StringRef File) override {
+      PPCallbacks *Callbacks = Compiler.getPreprocessor().getPPCallbacks();
+      std::unique_ptr<ASTConsumer> Consumer =
+          Factory->CreateASTConsumer(Compiler, File);
+      if (UsesPPCallbacks &&
+          Compiler.getPreprocessor().getPPCallbacks() != Callbacks)
+        *UsesPPCallbacks = true;
+      return Consumer;
+    }
+
+    void EndSourceFileAction() override {
+      if (!ReadFiles)
+        return;
+      SourceManager &SM = getCompilerInstance().getSourceManager();
+      FileManager &Files = getCompilerInstance().getFileManager();
+      for (auto I = SM.fileinfo_begin(), E = SM.fileinfo_end(); I != E; ++I) {
+        SmallString<128> Path(I->first->getName());
+        Files.FixupRelativePath(Path);
+        llvm::sys::fs::make_absolute(Path);
+        // The header of the preamble is temporary, the files it includes are
+        // only partially loaded from the PCH: use the list of the files read
+        // while building it instead.
+        if (!Preamble || Path.str() != Preamble->HeaderPath)
+          ReadFiles->push_back(Path.str());
+      }
+      if (Preamble)
+        ReadFiles->insert(ReadFiles->end(), Preamble->Files->begin(),
+                          Preamble->Files->end());
+    }
+
+  private:
+    ClangTidyASTConsumerFactory *Factory;
+    std::vector<std::string> *ReadFiles;
+    const ClangTidyPreambleStore::Preamble *Preamble;
+    bool *UsesPPCallbacks;
+  };
+
+  ClangTidyASTConsumerFactory ConsumerFactory;
+  std::vector<std::string> *ReadFiles;
+  const ClangTidyPreambleStore::Preamble *Preamble;
+  bool *UsesPPCallbacks;
+};
+
+/// \brief Forwards all requests to a \c ClangTidyOptionsProvider shared by
+/// the worker threads of a parallel run, serializing access to it.
+///
+/// The references returned by the providers stay valid after the lock is
+/// released, as they point to options that are never modified once cached.
+class SynchronizedOptionsProvider : public ClangTidyOptionsProvider {
+public:
+  SynchronizedOptionsProvider(ClangTidyOptionsProvider &Provider,
+                              std::mutex &Mutex)
+      : Provider(Provider), Mutex(Mutex) {}
+
+  const ClangTidyGlobalOptions &getGlobalOptions() override {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    return Provider.getGlobalOptions();
+  }
+
+  const ClangTidyOptions &getOptions(StringRef FileName) override {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    return Provider.getOptions(FileName);
+  }
+
+  bool invalidateChangedConfigFiles(StringRef FileName) override {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    return Provider.invalidateChangedConfigFiles(FileName);
+  }
+
+private:
+  ClangTidyOptionsProvider &Provider;
+  std::mutex &Mutex;
 };
 
+/// \brief Runs \p Factory on all compile commands of \p FilePath.
+///
+/// Unlike \c ClangTool::run, this doesn't change the working directory of the
+/// process, so several files can be processed concurrently.
+///
+/// If \p Preambles is not null and \p FilePath has a single compile command,
+/// a PCH of its preamble shared with the files that have the same one and the
+/// same \p OptionsKey is used when possible.
+///
+/// \returns \li true if successful or if there is no compile command
+///          \li false if a compile command failed
+bool runOnFile(const CompilationDatabase &Compilations, StringRef FilePath,
+               ActionFactory &Factory, DiagnosticConsumer &DiagConsumer,
+               std::mutex &OutputMutex, ClangTidyPreambleStore *Preambles,
+               StringRef OptionsKey) {
+  std::vector<CompileCommand> Commands =
+      Compilations.getCompileCommands(FilePath);
+  if (Commands.empty()) {
+    std::lock_guard<std::mutex> Lock(OutputMutex);
+    llvm::errs() << "Skipping " << FilePath
+                 << ". Compile command not found.\n";
+    return true;
+  }
+
+  bool Success = true;
+  for (const CompileCommand &Command : Commands) {
+    std::vector<std::string> CommandLine =
+        replace::getWorkingDirectoryCommandLine(Command);
+
+    ClangTidyPreambleStore::Preamble Preamble;
+    if (Preambles && Commands.size() == 1)
+      Preamble = Preambles->getPreamble(FilePath, Command.Directory,
+                                        CommandLine, OptionsKey);
+    bool UsesPPCallbacks = false;
+    if (Preamble.Usage == ClangTidyPreambleStore::PU_Probe)
+      Factory.detectPPCallbacks(&UsesPPCallbacks);
+    if (Preamble.Usage == ClangTidyPreambleStore::PU_Use)
+      Factory.usePreamble(&Preamble);
+
+    bool InvocationSucceeded = replace::runInWorkingDirectory(
+        std::move(CommandLine), Command.Directory, &Factory, &DiagConsumer);
+    Factory.detectPPCallbacks(nullptr);
+    Factory.usePreamble(nullptr);
+    if (Preamble.Usage == ClangTidyPreambleStore::PU_Probe)
+      Preambles->setProbeResult(Preamble.Key,
+                                InvocationSucceeded && !UsesPPCallbacks);
+    if (Preamble.Usage == ClangTidyPreambleStore::PU_Use && InvocationSucceeded)
+      Preambles->addReused();
+    if (!InvocationSucceeded) {
+      std::lock_guard<std::mutex> Lock(OutputMutex);
+      llvm::errs() << "Error while processing " << FilePath << ".\n";
+      Success = false;
+    }
+  }
+  return Success;
+}
+
+void mergeStats(ClangTidyStats &Stats, const ClangTidyStats &Other) {
+  Stats.ErrorsDisplayed += Other.ErrorsDisplayed;
+  Stats.ErrorsIgnoredCheckFilter += Other.ErrorsIgnoredCheckFilter;
+  Stats.ErrorsIgnoredNOLINT += Other.ErrorsIgnoredNOLINT;
+  Stats.ErrorsIgnoredNonUserCode += Other.ErrorsIgnoredNonUserCode;
+  Stats.ErrorsIgnoredLineFilter += Other.ErrorsIgnoredLineFilter;
+  Stats.ErrorsIgnoredCheckedHeader += Other.ErrorsIgnoredCheckedHeader;
+  Stats.CacheHits += Other.CacheHits;
+  Stats.CacheMisses += Other.CacheMisses;
+  Stats.PreamblesBuilt += Other.PreamblesBuilt;
+  Stats.PreamblesReused += Other.PreamblesReused;
+}
+
+/// \brief Returns the diagnostic counters accumulated between \p Before and
+/// \p After.
+ClangTidyStats getStatsDelta(const ClangTidyStats &After,
+                             const ClangTidyStats &Before) {
+  ClangTidyStats Delta;
+  Delta.ErrorsDisplayed = After.ErrorsDisplayed - Before.ErrorsDisplayed;
+  Delta.ErrorsIgnoredCheckFilter =
+      After.ErrorsIgnoredCheckFilter - Before.ErrorsIgnoredCheckFilter;
+  Delta.ErrorsIgnoredNOLINT =
+      After.ErrorsIgnoredNOLINT - Before.ErrorsIgnoredNOLINT;
+  Delta.ErrorsIgnoredNonUserCode =
+      After.ErrorsIgnoredNonUserCode - Before.ErrorsIgnoredNonUserCode;
+  Delta.ErrorsIgnoredLineFilter =
+      After.ErrorsIgnoredLineFilter - Before.ErrorsIgnoredLineFilter;
+  Delta.ErrorsIgnoredCheckedHeader =
+      After.ErrorsIgnoredCheckedHeader - Before.ErrorsIgnoredCheckedHeader;
+  return Delta;
+}
+
+/// \brief Processes \p InputFiles one by one on \p NumThreads worker threads,
+/// each with its own \c ClangTidyContext.
+///
+/// The errors of each input file are passed to \p Sink in the order of
+/// \p InputFiles, so the result doesn't depend on scheduling. They are only
+/// kept until the files before it are done. Errors repeated by several files
+/// are passed once. If \p Cache is not null, files whose results are cached
+/// are not processed again and the results of the others are stored. If
+/// \p Preambles is not null, files share the PCHs of their preambles.
+ClangTidyStats
+runClangTidyPerFile(ClangTidyOptionsProvider &OptionsProvider,
+                    const CompilationDatabase &Compilations,
+                    ArrayRef<std::string> InputFiles, ClangTidyErrorSink &Sink,
+                    ProfileData *Profile, unsigned NumThreads,
+                    const ClangTidyCache *Cache,
+                    ClangTidyPreambleStore *Preambles) {
+  // getAbsolutePath depends on the working directory, resolve all paths
+  // before starting any worker.
+  std::vector<std::string> AbsolutePaths;
+  for (const std::string &File : InputFiles)
+    AbsolutePaths.push_back(getAbsolutePath(File));
+
+  std::mutex OptionsMutex;
+  std::mutex OutputMutex;
+  std::atomic<unsigned> NextFile(0);
+  std::vector<ClangTidyStats> WorkerStats(NumThreads);
+  std::vector<ProfileData> WorkerProfiles(NumThreads);
+
+  // The errors of the files done while an earlier one is still processed.
+  std::mutex SinkMutex;
+  std::vector<std::vector<ClangTidyError>> FileErrors(AbsolutePaths.size());
+  std::vector<bool> FileDone(AbsolutePaths.size());
+  unsigned NextToPass = 0;
+  ClangTidyErrorSet UniqueErrors;
+  unsigned Duplicates = 0;
+  auto PassErrors = [&](unsigned I, std::vector<ClangTidyError> Errors) {
+    std::lock_guard<std::mutex> Lock(SinkMutex);
+    FileErrors[I] = std::move(Errors);
+    FileDone[I] = true;
+    for (; NextToPass < AbsolutePaths.size() && FileDone[NextToPass];
+         ++NextToPass) {
+      std::vector<ClangTidyError> Unique;
+      for (ClangTidyError &Error : FileErrors[NextToPass]) {
+        if (UniqueErrors.insert(Error))
+          Unique.push_back(std::move(Error));
+        else
+          ++Duplicates;
+      }
+      std::vector<ClangTidyError>().swap(FileErrors[NextToPass]);
+      if (!Unique.empty())
+        Sink.handleErrors(AbsolutePaths[NextToPass], Unique);
+    }
+  };
+
+  auto Worker = [&](unsigned WorkerIndex) {
+    ClangTidyContext Context(llvm::make_unique<SynchronizedOptionsProvider>(
+        OptionsProvider, OptionsMutex));
+    if (Profile)
+      Context.setCheckProfileData(&WorkerProfiles[WorkerIndex]);
+    ClangTidyDiagnosticConsumer DiagConsumer(Context);
+    ActionFactory Factory(Context);
+    ClangTidyStats CachedStats;
+
+    for (unsigned I = NextFile++; I < AbsolutePaths.size(); I = NextFile++) {
+      const std::string &FilePath = AbsolutePaths[I];
+      std::string CacheKey;
+      std::string OptionsKey;
+      std::vector<std::string> ReadFiles;
+      if (Cache || Preambles)
+        Context.setCurrentFile(FilePath);
+      if (Preambles)
+        OptionsKey = configurationAsText(Context.getOptions());
+      if (Cache) {
+        CacheKey = ClangTidyCache::getKey(
+            FilePath, Compilations.getCompileCommands(FilePath),
+            Context.getOptions(), Context.getGlobalOptions());
+        ClangTidyStats EntryStats;
+        std::vector<ClangTidyError> Errors;
+        if (Cache->lookup(CacheKey, Errors, EntryStats)) {
+          mergeStats(CachedStats, EntryStats);
+          ++CachedStats.CacheHits;
+          PassErrors(I, std::move(Errors));
+          continue;
+        }
+        ++CachedStats.CacheMisses;
+        Factory.recordReadFiles(&ReadFiles);
+        // The cache entry has to contain all errors of this file, including
+        // the ones already reported by other files.
+        Context.resetReportedErrors();
+      }
+
+      ClangTidyStats StatsBefore = Context.getStats();
+      bool Success = runOnFile(Compilations, FilePath, Factory, DiagConsumer,
+                               OutputMutex, Preambles, OptionsKey);
+      std::vector<ClangTidyError> Errors = Context.getErrors();
+      Context.clearErrors();
+      // Files without a compile command are skipped, not worth an entry.
+      if (Cache && Success && !ReadFiles.empty())
+        Cache->store(CacheKey, ReadFiles, Errors,
+                     getStatsDelta(Context.getStats(), StatsBefore));
+      PassErrors(I, std::move(Errors));
+    }
+    WorkerStats[WorkerIndex] = Context.getStats();
+    mergeStats(WorkerStats[WorkerIndex], CachedStats);
+  };
+
+  if (NumThreads == 1) {
+    Worker(0);
+  } else {
+    std::vector<std::thread> Threads;
+    for (unsigned I = 0; I < NumThreads; ++I)
+      Threads.emplace_back(Worker, I);
+    for (std::thread &Thread : Threads)
+      Thread.join();
+  }
+
+  assert(NextToPass == AbsolutePaths.size() && "Errors not passed to the sink");
+
+  ClangTidyStats Stats;
+  for (const ClangTidyStats &Other : WorkerStats)
+    mergeStats(Stats, Other);
+  Stats.ErrorsDisplayed -= Duplicates;
+  if (Preambles) {
+    Stats.PreamblesBuilt = Preambles->getNumBuilt();
+    Stats.PreamblesReused = Preambles->getNumReused();
+  }
+
+  if (Profile) {
+    for (ProfileData &WorkerProfile : WorkerProfiles) {
+      for (const auto &Record : WorkerProfile.Records)
+        Profile->Records[Record.getKey()] += Record.getValue();
+      std::move(WorkerProfile.TranslationUnits.begin(),
+                WorkerProfile.TranslationUnits.end(),
+                std::back_inserter(Profile->TranslationUnits));
+    }
+    std::stable_sort(Profile->TranslationUnits.begin(),
+                     Profile->TranslationUnits.end(),
+                     [](const TranslationUnitProfile &LHS,
+                        const TranslationUnitProfile &RHS) {
+                       return LHS.Start < RHS.Start;
+                     });
+  }
+  return Stats;
+}
+
+/// \brief Returns \c true if a warning about one of the nodes bound in
+/// \p Result can be reported.
+bool canReportMatch(ClangTidyContext &Context,
+                    const MatchFinder::MatchResult &Result) {
+  const BoundNodes::IDToNodeMap &Nodes = Result.Nodes.getMap();
+  if (Nodes.empty())
+    return true;
+  for (const auto &Node : Nodes) {
+    SourceLocation Loc = Node.second.getSourceRange().getBegin();
+    if (Loc.isInvalid() || Context.canReportAt(Loc))
+      return true;
+  }
+  return false;
+}
+
 } // namespace
 
 ClangTidyASTConsumerFactory::ClangTidyASTConsumerFactory(
@@ -213,33 +924,74 @@ ClangTidyASTConsumerFactory::CreateASTConsumer(
   Context.setCurrentFile(File);
   Context.setASTContext(&Compiler.getASTContext());
 
-  std::vector<std::unique_ptr<ClangTidyCheck>> Checks;
-  CheckFactories->createChecks(&Context, Checks);
-
-  ast_matchers::MatchFinder::MatchFinderOptions FinderOptions;
-  if (auto *P = Context.getCheckProfileData())
-    FinderOptions.CheckProfiling.emplace(P->Records);
+  // Each translation unit is profiled separately, the records are merged into
+  // the ProfileData of the context once it is complete.
+  ProfileData *Profile = Context.getCheckProfileData();
+  std::unique_ptr<TranslationUnitProfile> TUProfile;
+  if (Profile) {
+    TUProfile.reset(new TranslationUnitProfile);
+    TUProfile->File = File;
+    TimeRecord Now = TimeRecord::getCurrentTime(/*Start=*/true);
+    TUProfile->Start = Now.getWallTime();
+    TUProfile->Parse -= Now;
+  }
 
-  std::unique_ptr<ast_matchers::MatchFinder> Finder(
-      new ast_matchers::MatchFinder(std::move(FinderOptions)));
+  // The options of a translation unit stay alive and keep their address as
+  // long as the context, see ClangTidyContext::setCurrentFile().
+  std::unique_ptr<OptionsCheckSets> &Sets =
+      CheckSetsByOptions[&Context.getOptions()];
+  if (!Sets) {
+    Sets.reset(new OptionsCheckSets);
+    CheckFactories->createChecks(&Context, Sets->Probes);
+  }
+  // Only the checks that can fire in this translation unit run.
+  CheckCostClass MaxCost = Context.getGlobalOptions().MaxCheckCost;
+  std::vector<bool> Enabled;
+  for (const auto &Probe : Sets->Probes)
+    Enabled.push_back(Probe->getCostClass() <= MaxCost &&
+                      Probe->isLanguageSupported(Compiler.getLangOpts()));
 
-  for (auto &Check : Checks) {
-    Check->registerMatchers(&*Finder);
-    Check->registerPPCallbacks(Compiler);
+  std::unique_ptr<ClangTidyCheckSet> &ReusableChecks = Sets->Reusable[Enabled];
+  std::unique_ptr<ClangTidyCheckSet> OwnedChecks;
+  ClangTidyCheckSet *Checks = ReusableChecks.get();
+  if (!Checks) {
+    OwnedChecks = createCheckSet(Enabled);
+    Checks = OwnedChecks.get();
+    if (Checks->Reusable)
+      ReusableChecks = std::move(OwnedChecks);
   }
+  for (auto &Check : Checks->Checks)
+    Check->registerPPCallbacks(Compiler);
 
   std::vector<std::unique_ptr<ASTConsumer>> Consumers;
-  if (!Checks.empty())
-    Consumers.push_back(Finder->newASTConsumer());
+  if (!Checks->Checks.empty()) {
+    auto MatchConsumer =
+        llvm::make_unique<CheckSetMatchConsumer>(*Checks, Context);
+    if (TUProfile)
+      Consumers.push_back(llvm::make_unique<TimedConsumer>(
+          std::move(MatchConsumer), TUProfile->Matchers));
+    else
+      Consumers.push_back(std::move(MatchConsumer));
+  }
 
   AnalyzerOptionsRef AnalyzerOptions = Compiler.getAnalyzerOpts();
   // FIXME: Remove this option once clang's cfg-temporary-dtors option defaults
   // to true.
   AnalyzerOptions->Config["cfg-temporary-dtors"] =
       Context.getOptions().AnalyzeTemporaryDtors ? "true" : "false";
+  // The analyzer stops exploring the paths of a top-level function once it
+  // created this many nodes for it.
+  if (Context.getOptions().AnalyzerMaxNodes)
+    AnalyzerOptions->Config["max-nodes"] =
+        llvm::utostr(*Context.getOptions().AnalyzerMaxNodes);
 
   GlobList &Filter = Context.getChecksFilter();
-  AnalyzerOptions->CheckersControlList = getCheckersControlList(Filter);
+  // Checkers enabled on the command line, e.g. with -Xclang
+  // -analyzer-checker=, would still run the analyzer.
+  if (MaxCost >= CCC_PathSensitive)
+    AnalyzerOptions->CheckersControlList = getCheckersControlList(Filter);
+  else
+    AnalyzerOptions->CheckersControlList.clear();
   if (!AnalyzerOptions->CheckersControlList.empty()) {
     AnalyzerOptions->AnalysisStoreOpt = RegionStoreModel;
     AnalyzerOptions->AnalysisDiagOpt = PD_NONE;
@@ -249,10 +1001,37 @@ ClangTidyASTConsumerFactory::CreateASTConsumer(
         ento::CreateAnalysisConsumer(Compiler);
     AnalysisConsumer->AddDiagnosticConsumer(
         new AnalyzerDiagnosticConsumer(Context));
-    Consumers.push_back(std::move(AnalysisConsumer));
+    if (TUProfile)
+      Consumers.push_back(llvm::make_unique<TimedConsumer>(
+          std::move(AnalysisConsumer), TUProfile->Analyzer));
+    else
+      Consumers.push_back(std::move(AnalysisConsumer));
   }
   return llvm::make_unique<ClangTidyASTConsumer>(
-      std::move(Consumers), std::move(Finder), std::move(Checks));
+      std::move(Consumers), std::move(OwnedChecks), *Checks,
+      std::move(TUProfile), Profile);
+}
+
+std::unique_ptr<ClangTidyCheckSet>
+ClangTidyASTConsumerFactory::createCheckSet(const std::vector<bool> &Enabled) {
+  std::unique_ptr<ClangTidyCheckSet> Checks(new ClangTidyCheckSet);
+  std::vector<std::unique_ptr<ClangTidyCheck>> AllChecks;
+  CheckFactories->createChecks(&Context, AllChecks);
+  assert(AllChecks.size() == Enabled.size());
+  for (size_t I = 0, E = AllChecks.size(); I != E; ++I)
+    if (Enabled[I])
+      Checks->Checks.push_back(std::move(AllChecks[I]));
+  Checks->Reusable =
+      std::all_of(Checks->Checks.begin(), Checks->Checks.end(),
+                  [](const std::unique_ptr<ClangTidyCheck> &Check) {
+                    return Check->isReusable();
+                  });
+  Checks->HasPrerequisites =
+      std::any_of(Checks->Checks.begin(), Checks->Checks.end(),
+                  [](const std::unique_ptr<ClangTidyCheck> &Check) {
+                    return !Check->getRequiredIdentifiers().empty();
+                  });
+  return Checks;
 }
 
 std::vector<std::string> ClangTidyASTConsumerFactory::getCheckNames() {
@@ -317,6 +1096,9 @@ DiagnosticBuilder ClangTidyCheck::diag(SourceLocation Loc, StringRef Message,
 
 void ClangTidyCheck::run(const ast_matchers::MatchFinder::MatchResult &Result) {
   Context->setSourceManager(Result.SourceManager);
+  if (Context->skipsFilteredCode() && isLocationLocal() &&
+      !canReportMatch(*Context, Result))
+    return;
   check(Result);
 }
 
@@ -360,61 +1142,224 @@ ClangTidyOptions::OptionMap getCheckOptions(const ClangTidyOptions &Options) {
 ClangTidyStats
 runClangTidy(std::unique_ptr<ClangTidyOptionsProvider> OptionsProvider,
              const tooling::CompilationDatabase &Compilations,
-             ArrayRef<std::string> InputFiles,
-             std::vector<ClangTidyError> *Errors, ProfileData *Profile) {
+             ArrayRef<std::string> InputFiles, ClangTidyErrorSink &Sink,
+             ProfileData *Profile, unsigned NumThreads,
+             StringRef CacheDirectory, bool ReusePreambles) {
+  if (NumThreads == 0)
+    NumThreads = std::thread::hardware_concurrency();
+  NumThreads = std::max(1u, std::min<unsigned>(NumThreads, InputFiles.size()));
+  if (!llvm::llvm_is_multithreaded())
+    NumThreads = 1;
+
+  std::unique_ptr<ClangTidyCache> Cache;
+  if (!CacheDirectory.empty())
+    Cache.reset(new ClangTidyCache(CacheDirectory));
+  std::unique_ptr<ClangTidyPreambleStore> Preambles;
+  if (ReusePreambles)
+    Preambles.reset(new ClangTidyPreambleStore());
+  if (Cache || Preambles || NumThreads > 1) {
+    ClangTidyStats Stats = runClangTidyPerFile(
+        *OptionsProvider, Compilations, InputFiles, Sink, Profile, NumThreads,
+        Cache.get(), Preambles.get());
+    Sink.finish();
+    return Stats;
+  }
+
   ClangTool Tool(Compilations, InputFiles);
   clang::tidy::ClangTidyContext Context(std::move(OptionsProvider));
   if (Profile)
     Context.setCheckProfileData(Profile);
+  // The context already drops the errors repeated by several files.
+  Context.setErrorSink(&Sink);
 
   ClangTidyDiagnosticConsumer DiagConsumer(Context);
 
   Tool.setDiagnosticConsumer(&DiagConsumer);
 
-  class ActionFactory : public FrontendActionFactory {
-  public:
-    ActionFactory(ClangTidyContext &Context) : ConsumerFactory(Context) {}
-    FrontendAction *create() override { return new Action(&ConsumerFactory); }
-
-  private:
-    class Action : public ASTFrontendAction {
-    public:
-      Action(ClangTidyASTConsumerFactory *Factory) : Factory(Factory) {}
-      std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance &Compiler,
-                                                     StringRef File) override {
-        return Factory->CreateASTConsumer(Compiler, File);
-      }
-
-    private:
-      ClangTidyASTConsumerFactory *Factory;
-    };
-
-    ClangTidyASTConsumerFactory ConsumerFactory;
-  };
-
   ActionFactory Factory(Context);
   Tool.run(&Factory);
-  *Errors = Context.getErrors();
+  Sink.finish();
   return Context.getStats();
 }
 
+ClangTidyStats
+runClangTidy(std::unique_ptr<ClangTidyOptionsProvider> OptionsProvider,
+             const tooling::CompilationDatabase &Compilations,
+             ArrayRef<std::string> InputFiles,
+             std::vector<ClangTidyError> *Errors, ProfileData *Profile,
+             unsigned NumThreads, StringRef CacheDirectory,
+             bool ReusePreambles) {
+  Errors->clear();
+  ErrorCollector Collector(*Errors);
+  return runClangTidy(std::move(OptionsProvider), Compilations, InputFiles,
+                      Collector, Profile, NumThreads, CacheDirectory,
+                      ReusePreambles);
+}
+
 void handleErrors(const std::vector<ClangTidyError> &Errors, bool Fix) {
   ErrorReporter Reporter(Fix);
-  for (const ClangTidyError &Error : Errors)
-    Reporter.reportDiagnostic(Error);
-  Reporter.Finish();
+  Reporter.handleErrors(StringRef(), Errors);
+  Reporter.finish();
 }
 
 void exportReplacements(const std::vector<ClangTidyError> &Errors,
-                        raw_ostream &OS) {
+                        raw_ostream &OS, bool Binary) {
   tooling::TranslationUnitReplacements TUR;
   for (const ClangTidyError &Error : Errors)
     TUR.Replacements.insert(TUR.Replacements.end(), Error.Fix.begin(),
                             Error.Fix.end());
 
+  if (Binary) {
+    replace::writeBinaryReplacements(TUR, OS);
+    return;
+  }
+
   yaml::Output YAML(OS);
   YAML << TUR;
 }
 
+std::unique_ptr<ClangTidyErrorSink> createErrorReporter(bool Fix) {
+  return llvm::make_unique<ErrorReporter>(Fix);
+}
+
+std::unique_ptr<ClangTidyErrorSink>
+createReplacementsExporter(StringRef Path, bool Binary, std::error_code &EC) {
+  return llvm::make_unique<ReplacementsExporter>(Path, Binary, EC);
+}
+
+namespace {
+void writeJSONString(raw_ostream &OS, StringRef S) {
+  OS << '"';
+  for (unsigned char C : S) {
+    if (C == '"' || C == '\\')
+      OS << '\\' << C;
+    else if (C < 0x20)
+      OS << format("\\u%04x", C);
+    else
+      OS << C;
+  }
+  OS << '"';
+}
+
+// Times computed as differences can be slightly negative when they are close
+// to 0, don't print these as "-0".
+void writeSeconds(raw_ostream &OS, double Seconds) {
+  OS << format("%.6f", std::max(Seconds, 0.0));
+}
+
+void writeMicroseconds(raw_ostream &OS, double Seconds) {
+  OS << format("%.0f", std::max(Seconds, 0.0) * 1e6);
+}
+
+void writeCheckTimes(raw_ostream &OS, const StringMap<TimeRecord> &Records,
+                     bool Microseconds, StringRef Indent) {
+  // StringMap iteration order isn't deterministic.
+  std::vector<StringRef> Names;
+  for (const auto &Record : Records)
+    Names.push_back(Record.getKey());
+  std::sort(Names.begin(), Names.end());
+  OS << "{";
+  for (size_t I = 0, E = Names.size(); I != E; ++I) {
+    OS << (I ? ",\n" : "\n") << Indent << "  ";
+    writeJSONString(OS, Names[I]);
+    OS << ": ";
+    double Wall = Records.lookup(Names[I]).getWallTime();
+    if (Microseconds)
+      writeMicroseconds(OS, Wall);
+    else
+      writeSeconds(OS, Wall);
+  }
+  if (!Names.empty())
+    OS << "\n" << Indent;
+  OS << "}";
+}
+
+/// \brief Writes the translation units as complete events of the Chrome trace
+/// event format, with their phases nested in them. Translation units processed
+/// concurrently are put on different threads.
+void exportChromeTrace(const ProfileData &Profile, raw_ostream &OS) {
+  double Origin = Profile.TranslationUnits.empty()
+                      ? 0
+                      : Profile.TranslationUnits.front().Start;
+  std::vector<double> ThreadEnds;
+  bool First = true;
+  auto writeEvent = [&](StringRef Name, StringRef Category, unsigned Thread,
+                        double Start, double Duration) {
+    OS << (First ? "\n" : ",\n") << "    {\"name\": ";
+    First = false;
+    writeJSONString(OS, Name);
+    OS << ", \"cat\": \"" << Category << "\", \"ph\": \"X\", \"pid\": 1"
+       << ", \"tid\": " << Thread << ", \"ts\": ";
+    writeMicroseconds(OS, Start - Origin);
+    OS << ", \"dur\": ";
+    writeMicroseconds(OS, Duration);
+  };
+
+  OS << "{\n  \"traceEvents\": [";
+  for (const TranslationUnitProfile &TU : Profile.TranslationUnits) {
+    double Parse = TU.Parse.getWallTime();
+    double Matchers = TU.Matchers.getWallTime();
+    double Analyzer = TU.Analyzer.getWallTime();
+    double End = TU.Start + Parse + Matchers + Analyzer;
+    unsigned Thread = 0;
+    while (Thread < ThreadEnds.size() && ThreadEnds[Thread] > TU.Start)
+      ++Thread;
+    if (Thread == ThreadEnds.size())
+      ThreadEnds.push_back(End);
+    else
+      ThreadEnds[Thread] = End;
+
+    writeEvent(TU.File, "translation-unit", Thread, TU.Start, End - TU.Start);
+    OS << ", \"args\": {\"process_peak_rss_after\": "
+       << TU.ProcessPeakRSSAfter << "}}";
+    writeEvent("parse", "phase", Thread, TU.Start, Parse);
+    OS << "}";
+    writeEvent("matchers", "phase", Thread, TU.Start + Parse, Matchers);
+    OS << ", \"args\": ";
+    writeCheckTimes(OS, TU.Checks, /*Microseconds=*/true, "      ");
+    OS << "}";
+    writeEvent("analyzer", "phase", Thread, TU.Start + Parse + Matchers,
+               Analyzer);
+    OS << "}";
+  }
+  OS << "\n  ],\n  \"displayTimeUnit\": \"ms\"\n}\n";
+}
+} // end anonymous namespace
+
+void exportProfile(const ProfileData &Profile, raw_ostream &OS,
+                   bool ChromeTrace) {
+  if (ChromeTrace) {
+    exportChromeTrace(Profile, OS);
+    return;
+  }
+
+  double Origin = Profile.TranslationUnits.empty()
+                      ? 0
+                      : Profile.TranslationUnits.front().Start;
+  OS << "{\n  \"translation_units\": [";
+  for (size_t I = 0, E = Profile.TranslationUnits.size(); I != E; ++I) {
+    const TranslationUnitProfile &TU = Profile.TranslationUnits[I];
+    OS << (I ? ",\n" : "\n") << "    {\n      \"file\": ";
+    writeJSONString(OS, TU.File);
+    OS << ",\n      \"start\": ";
+    writeSeconds(OS, TU.Start - Origin);
+    OS << ",\n      \"parse\": ";
+    writeSeconds(OS, TU.Parse.getWallTime());
+    OS << ",\n      \"matchers\": ";
+    writeSeconds(OS, TU.Matchers.getWallTime());
+    OS << ",\n      \"analyzer\": ";
+    writeSeconds(OS, TU.Analyzer.getWallTime());
+    OS << ",\n      \"process_peak_rss_after\": " << TU.ProcessPeakRSSAfter
+       << ",\n      \"checks\": ";
+    writeCheckTimes(OS, TU.Checks, /*Microseconds=*/false, "      ");
+    OS << "\n    }";
+  }
+  if (!Profile.TranslationUnits.empty())
+    OS << "\n  ";
+  OS << "],\n  \"checks\": ";
+  writeCheckTimes(OS, Profile.Records, /*Microseconds=*/false, "  ");
+  OS << "\n}\n";
+}
+
 } // namespace tidy
 } // namespace clang
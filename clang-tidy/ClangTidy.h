@@ -14,11 +14,14 @@
 #include "ClangTidyOptions.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
 #include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/LangOptions.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Tooling/Refactoring.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/raw_ostream.h"
+#include <map>
 #include <memory>
+#include <system_error>
 #include <type_traits>
 #include <vector>
 
@@ -139,10 +142,8 @@ private:
 /// and then overwrite \c check(const MatchResult &Result) to do the actual
 /// check for each match.
 ///
-/// A new \c ClangTidyCheck instance is created per translation unit.
-///
-/// FIXME: Figure out whether carrying information from one TU to another is
-/// useful/necessary.
+/// A new \c ClangTidyCheck instance is created per translation unit, unless
+/// all enabled checks are reusable (see \c isReusable()).
 class ClangTidyCheck : public ast_matchers::MatchFinder::MatchCallback {
 public:
   /// \brief Initializes the check with \p CheckName and \p Context.
@@ -183,10 +184,63 @@ public:
   /// work in here.
   virtual void check(const ast_matchers::MatchFinder::MatchResult & /*Result*/) {}
 
+  /// \brief Overwrite this to return \c true if the check only reports
+  /// warnings inside the declarations its matchers match.
+  ///
+  /// With \c ClangTidyGlobalOptions::SkipFilteredCode, \c check() isn't
+  /// called for the matches of such checks whose bound nodes are all in files
+  /// whose warnings are never reported, e.g. system headers.
+  virtual bool isLocationLocal() const { return false; }
+
+  /// \brief Overwrite this to return \c true if the check keeps no state from
+  /// one translation unit to the next, except what it resets in
+  /// \c onStartOfTranslationUnit() or \c onEndOfTranslationUnit().
+  ///
+  /// If all enabled checks are reusable, they are created and their matchers
+  /// are registered once for all translation units with the same options.
+  /// \c registerPPCallbacks() is still called for each translation unit.
+  virtual bool isReusable() const { return false; }
+
+  /// \brief Overwrite this to return the cost class of the check.
+  ///
+  /// Checks more expensive than \c ClangTidyGlobalOptions::MaxCheckCost don't
+  /// run. Most checks only look at the nodes their matchers match.
+  virtual CheckCostClass getCostClass() const { return CCC_ASTLocal; }
+
+  /// \brief Overwrite this to return \c false for the languages in which the
+  /// check can't report anything, e.g. C for checks of C++ constructs.
+  ///
+  /// The matchers and preprocessor callbacks of the check aren't registered
+  /// for translation units in these languages.
+  virtual bool isLanguageSupported(const LangOptions & /*LangOpts*/) const {
+    return true;
+  }
+
+  /// \brief Overwrite this to return identifiers one of which has to appear
+  /// in a translation unit for the matchers of the check to find anything in
+  /// it, e.g. the name of the function it looks for calls to.
+  ///
+  /// This is only known once the translation unit is parsed: the matchers of
+  /// the check don't run, but its preprocessor callbacks are registered
+  /// anyway. Translation units using a precompiled header or modules always
+  /// run them. An empty list means there is no such prerequisite.
+  virtual std::vector<StringRef> getRequiredIdentifiers() const {
+    return std::vector<StringRef>();
+  }
+
   /// \brief Add a diagnostic with the check's name.
   DiagnosticBuilder diag(SourceLocation Loc, StringRef Description,
                          DiagnosticIDs::Level Level = DiagnosticIDs::Warning);
 
+  /// \brief Returns the raw tokens of \p FID, shared by all checks in the
+  /// current translation unit.
+  ///
+  /// Prefer this to running a raw \c Lexer at each match.
+  const TokenIndex &getTokenIndex(const SourceManager &SM, FileID FID,
+                                  const LangOptions &LangOpts) {
+    return Context->getTokenIndex(SM, FID, LangOpts);
+  }
+
   /// \brief Should store all options supported by this check with their
   /// current values or default values for options that haven't been overridden.
   ///
@@ -206,6 +260,7 @@ protected:
 };
 
 class ClangTidyCheckFactories;
+struct ClangTidyCheckSet;
 
 class ClangTidyASTConsumerFactory {
 public:
@@ -225,8 +280,25 @@ private:
   typedef std::vector<std::pair<std::string, bool>> CheckersList;
   CheckersList getCheckersControlList(GlobList &Filter);
 
+  /// \brief Creates the checks enabled for the current file, keeps those for
+  /// which \p Enabled is \c true and registers their matchers.
+  std::unique_ptr<ClangTidyCheckSet>
+  createCheckSet(const std::vector<bool> &Enabled);
+
+  /// \brief The checks created for one set of options.
+  struct OptionsCheckSets {
+    /// \brief One instance of each enabled check, only asked for its cost
+    /// class and supported languages.
+    std::vector<std::unique_ptr<ClangTidyCheck>> Probes;
+    /// \brief Reusable check sets by the probes they keep.
+    std::map<std::vector<bool>, std::unique_ptr<ClangTidyCheckSet>> Reusable;
+  };
+
   ClangTidyContext &Context;
   std::unique_ptr<ClangTidyCheckFactories> CheckFactories;
+  /// \brief The checks by the options they were created with.
+  llvm::DenseMap<const ClangTidyOptions *, std::unique_ptr<OptionsCheckSets>>
+      CheckSetsByOptions;
 };
 
 /// \brief Fills the list of check names that are enabled when the provided
@@ -243,14 +315,41 @@ ClangTidyOptions::OptionMap getCheckOptions(const ClangTidyOptions &Options);
 
 /// \brief Run a set of clang-tidy checks on a set of files.
 ///
+/// The errors of each file are passed to \p Sink as soon as it and the files
+/// before it in \p InputFiles are processed, then \p Sink is finished.
+///
 /// \param Profile if provided, it enables check profile collection in
 /// MatchFinder, and will contain the result of the profile.
+///
+/// \param NumThreads the number of translation units to process concurrently.
+/// If 0, the number of hardware threads is used. Errors are passed in the
+/// order of \p InputFiles regardless of this value.
+///
+/// \param CacheDirectory if not empty, the results of each translation unit
+/// are cached in this directory, and translation units whose sources, compile
+/// commands and options didn't change since they were cached are not processed
+/// again.
+///
+/// \param ReusePreambles if true, translation units starting with the same
+/// block of includes and compiled with the same command and options share a
+/// PCH of these includes, when this doesn't change the results.
+ClangTidyStats
+runClangTidy(std::unique_ptr<ClangTidyOptionsProvider> OptionsProvider,
+             const tooling::CompilationDatabase &Compilations,
+             ArrayRef<std::string> InputFiles, ClangTidyErrorSink &Sink,
+             ProfileData *Profile = nullptr, unsigned NumThreads = 1,
+             StringRef CacheDirectory = StringRef(),
+             bool ReusePreambles = false);
+
+/// \brief Like the overload above, but collects all errors in \p Errors.
 ClangTidyStats
 runClangTidy(std::unique_ptr<ClangTidyOptionsProvider> OptionsProvider,
              const tooling::CompilationDatabase &Compilations,
              ArrayRef<std::string> InputFiles,
              std::vector<ClangTidyError> *Errors,
-             ProfileData *Profile = nullptr);
+             ProfileData *Profile = nullptr, unsigned NumThreads = 1,
+             StringRef CacheDirectory = StringRef(),
+             bool ReusePreambles = false);
 
 // FIXME: This interface will need to be significantly extended to be useful.
 // FIXME: Implement confidence levels for displaying/fixing errors.
@@ -261,8 +360,34 @@ void handleErrors(const std::vector<ClangTidyError> &Errors, bool Fix);
 
 /// \brief Serializes replacements into YAML and writes them to the specified
 /// output stream.
+///
+/// If \p Binary is true, the compact binary format read by
+/// clang-apply-replacements is used instead of YAML.
 void exportReplacements(const std::vector<ClangTidyError> &Errors,
-                        raw_ostream &OS);
+                        raw_ostream &OS, bool Binary = false);
+
+/// \brief Returns a sink displaying the errors it receives right away, like
+/// \c handleErrors(). If \p Fix is true, the fixes are applied to the files
+/// when the sink is finished.
+std::unique_ptr<ClangTidyErrorSink> createErrorReporter(bool Fix);
+
+/// \brief Returns a sink writing the fixes it receives to the file \p Path as
+/// a single \c TranslationUnitReplacements, like \c exportReplacements().
+///
+/// The file is only created if any error is received. YAML replacements are
+/// written as soon as they are received. If the file can't be opened or
+/// written, \p EC is set, at the latest when the sink is finished.
+std::unique_ptr<ClangTidyErrorSink>
+createReplacementsExporter(StringRef Path, bool Binary, std::error_code &EC);
+
+/// \brief Writes the per-translation unit and per-check times of \p Profile to
+/// \p OS as JSON.
+///
+/// Times are in seconds of wall time, the start of each translation unit is
+/// relative to the first one. If \p ChromeTrace is true, the Chrome trace
+/// event format is used instead, with times in microseconds.
+void exportProfile(const ProfileData &Profile, raw_ostream &OS,
+                   bool ChromeTrace = false);
 
 } // end namespace tidy
 } // end namespace clang
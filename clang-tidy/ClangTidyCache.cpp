@@ -0,0 +1,330 @@
+//===--- ClangTidyCache.cpp - clang-tidy ------------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+///  \file This file implements the on-disk cache of clang-tidy results.
+///
+///  An entry is a single file named after its key, made of ULEB128 integers
+///  and length-prefixed strings:
+///    - magic and format version,
+///    - the files read by the translation unit with the MD5 of their contents,
+///    - the \c ClangTidyStats counters of the translation unit,
+///    - the \c ClangTidyErrors with their notes and fixes.
+///
+//===----------------------------------------------------------------------===//
+
+#include "ClangTidyCache.h"
+#include "clang/Basic/Version.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include <climits>
+
+namespace clang {
+namespace tidy {
+
+namespace {
+
+const char EntryMagic[] = "CTCE";
+// Bump whenever the entry layout or the key computation changes.
+const unsigned EntryVersion = 3;
+
+void hashString(llvm::MD5 &Hash, StringRef S) {
+  uint64_t Size = S.size();
+  Hash.update(ArrayRef<uint8_t>(reinterpret_cast<const uint8_t *>(&Size),
+                                sizeof(Size)));
+  Hash.update(S);
+}
+
+std::string finalizeHash(llvm::MD5 &Hash) {
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Hex;
+  llvm::MD5::stringifyResult(Result, Hex);
+  return Hex.str();
+}
+
+/// \brief Computes the MD5 of the contents of \p Path, or returns an empty
+/// string if the file can't be read.
+std::string hashFileContents(StringRef Path) {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Buffer =
+      llvm::MemoryBuffer::getFile(Path);
+  if (!Buffer)
+    return std::string();
+  llvm::MD5 Hash;
+  Hash.update(Buffer.get()->getBuffer());
+  return finalizeHash(Hash);
+}
+
+class EntryWriter {
+public:
+  EntryWriter(raw_ostream &OS) : OS(OS) {}
+
+  void writeInt(uint64_t Value) { llvm::encodeULEB128(Value, OS); }
+
+  void writeString(StringRef S) {
+    writeInt(S.size());
+    OS << S;
+  }
+
+  void writeMessage(const ClangTidyMessage &Message) {
+    writeString(Message.Message);
+    writeString(Message.FilePath);
+    writeInt(Message.FileOffset);
+  }
+
+private:
+  raw_ostream &OS;
+};
+
+/// \brief Reads what \c EntryWriter wrote, failing instead of reading past
+/// the end of the buffer.
+class EntryReader {
+public:
+  EntryReader(StringRef Buffer) : Buffer(Buffer) {}
+
+  bool readInt(uint64_t &Result) {
+    Result = 0;
+    for (unsigned Shift = 0; Shift < 64; Shift += 7) {
+      if (Buffer.empty())
+        return false;
+      uint8_t Byte = Buffer.front();
+      Buffer = Buffer.drop_front();
+      Result |= uint64_t(Byte & 0x7f) << Shift;
+      if (!(Byte & 0x80))
+        return true;
+    }
+    return false;
+  }
+
+  bool readUnsigned(unsigned &Result) {
+    uint64_t Value;
+    if (!readInt(Value) || Value > UINT_MAX)
+      return false;
+    Result = Value;
+    return true;
+  }
+
+  bool readString(std::string &Result) {
+    uint64_t Size;
+    if (!readInt(Size) || Size > Buffer.size())
+      return false;
+    Result = Buffer.substr(0, Size);
+    Buffer = Buffer.drop_front(Size);
+    return true;
+  }
+
+  bool readMessage(ClangTidyMessage &Message) {
+    return readString(Message.Message) && readString(Message.FilePath) &&
+           readUnsigned(Message.FileOffset);
+  }
+
+  bool readError(std::vector<ClangTidyError> &Errors) {
+    std::string CheckName;
+    unsigned Level;
+    if (!readString(CheckName) || !readUnsigned(Level))
+      return false;
+    Errors.push_back(ClangTidyError(
+        CheckName, static_cast<ClangTidyError::Level>(Level)));
+    ClangTidyError &Error = Errors.back();
+    if (!readMessage(Error.Message))
+      return false;
+
+    uint64_t NumNotes;
+    if (!readInt(NumNotes) || NumNotes > Buffer.size())
+      return false;
+    Error.Notes.resize(NumNotes);
+    for (ClangTidyMessage &Note : Error.Notes)
+      if (!readMessage(Note))
+        return false;
+
+    uint64_t NumFixes;
+    if (!readInt(NumFixes) || NumFixes > Buffer.size())
+      return false;
+    for (uint64_t I = 0; I != NumFixes; ++I) {
+      std::string FilePath, Text;
+      unsigned Offset, Length;
+      if (!readString(FilePath) || !readUnsigned(Offset) ||
+          !readUnsigned(Length) || !readString(Text))
+        return false;
+      Error.Fix.insert(tooling::Replacement(FilePath, Offset, Length, Text));
+    }
+    return true;
+  }
+
+private:
+  StringRef Buffer;
+};
+
+} // namespace
+
+ClangTidyCache::ClangTidyCache(StringRef Directory) : Directory(Directory) {
+  llvm::sys::fs::create_directories(Directory);
+}
+
+std::string
+ClangTidyCache::getKey(StringRef FilePath,
+                       ArrayRef<tooling::CompileCommand> Commands,
+                       const ClangTidyOptions &Options,
+                       const ClangTidyGlobalOptions &GlobalOptions) {
+  llvm::MD5 Hash;
+  hashString(Hash, EntryMagic);
+  hashString(Hash, llvm::utostr(EntryVersion));
+  hashString(Hash, getClangFullVersion());
+  hashString(Hash, FilePath);
+  for (const tooling::CompileCommand &Command : Commands) {
+    hashString(Hash, Command.Directory);
+    for (const std::string &Arg : Command.CommandLine)
+      hashString(Hash, Arg);
+  }
+  hashString(Hash, configurationAsText(Options));
+  // SystemHeaders isn't part of the YAML form.
+  if (Options.SystemHeaders && *Options.SystemHeaders)
+    hashString(Hash, "system-headers");
+  for (const FileFilter &Filter : GlobalOptions.LineFilter) {
+    hashString(Hash, Filter.Name);
+    for (const FileFilter::LineRange &Range : Filter.LineRanges) {
+      hashString(Hash, llvm::utostr(Range.first));
+      hashString(Hash, llvm::utostr(Range.second));
+    }
+  }
+  if (GlobalOptions.SkipFilteredCode)
+    hashString(Hash, "skip-filtered-code");
+  if (GlobalOptions.MaxCheckCost != CCC_PathSensitive)
+    hashString(Hash,
+               "max-check-cost=" + llvm::utostr(GlobalOptions.MaxCheckCost));
+  return finalizeHash(Hash);
+}
+
+std::string ClangTidyCache::getEntryPath(StringRef Key) const {
+  SmallString<128> Path(Directory);
+  llvm::sys::path::append(Path, Key);
+  return Path.str();
+}
+
+bool ClangTidyCache::lookup(StringRef Key, std::vector<ClangTidyError> &Errors,
+                            ClangTidyStats &Stats) const {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Buffer =
+      llvm::MemoryBuffer::getFile(getEntryPath(Key));
+  if (!Buffer)
+    return false;
+
+  StringRef Contents = Buffer.get()->getBuffer();
+  StringRef Magic(EntryMagic);
+  if (!Contents.startswith(Magic))
+    return false;
+  EntryReader Reader(Contents.drop_front(Magic.size()));
+
+  uint64_t Version;
+  if (!Reader.readInt(Version) || Version != EntryVersion)
+    return false;
+
+  uint64_t NumFiles;
+  if (!Reader.readInt(NumFiles) || NumFiles > Contents.size())
+    return false;
+  for (uint64_t I = 0; I != NumFiles; ++I) {
+    std::string Path, FileHash;
+    if (!Reader.readString(Path) || !Reader.readString(FileHash) ||
+        hashFileContents(Path) != FileHash)
+      return false;
+  }
+
+  ClangTidyStats EntryStats;
+  if (!Reader.readUnsigned(EntryStats.ErrorsDisplayed) ||
+      !Reader.readUnsigned(EntryStats.ErrorsIgnoredCheckFilter) ||
+      !Reader.readUnsigned(EntryStats.ErrorsIgnoredNOLINT) ||
+      !Reader.readUnsigned(EntryStats.ErrorsIgnoredNonUserCode) ||
+      !Reader.readUnsigned(EntryStats.ErrorsIgnoredLineFilter) ||
+      !Reader.readUnsigned(EntryStats.ErrorsIgnoredCheckedHeader))
+    return false;
+
+  uint64_t NumErrors;
+  if (!Reader.readInt(NumErrors) || NumErrors > Contents.size())
+    return false;
+  std::vector<ClangTidyError> EntryErrors;
+  for (uint64_t I = 0; I != NumErrors; ++I)
+    if (!Reader.readError(EntryErrors))
+      return false;
+
+  Errors = std::move(EntryErrors);
+  Stats = EntryStats;
+  return true;
+}
+
+void ClangTidyCache::store(StringRef Key, ArrayRef<std::string> ReadFiles,
+                           const std::vector<ClangTidyError> &Errors,
+                           const ClangTidyStats &Stats) const {
+  std::vector<std::pair<StringRef, std::string>> FileHashes;
+  for (const std::string &Path : ReadFiles) {
+    std::string FileHash = hashFileContents(Path);
+    // A file that can't be read now can't be checked on lookup either.
+    if (FileHash.empty())
+      return;
+    FileHashes.push_back(std::make_pair(Path, FileHash));
+  }
+
+  // Write to a temporary file first, so that concurrent lookups never see a
+  // partially written entry.
+  SmallString<128> TempPath;
+  int FD;
+  if (llvm::sys::fs::createUniqueFile(getEntryPath(Key) + "-%%%%%%%%", FD,
+                                      TempPath))
+    return;
+  {
+    llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << EntryMagic;
+    EntryWriter Writer(OS);
+    Writer.writeInt(EntryVersion);
+
+    Writer.writeInt(FileHashes.size());
+    for (const auto &FileHash : FileHashes) {
+      Writer.writeString(FileHash.first);
+      Writer.writeString(FileHash.second);
+    }
+
+    Writer.writeInt(Stats.ErrorsDisplayed);
+    Writer.writeInt(Stats.ErrorsIgnoredCheckFilter);
+    Writer.writeInt(Stats.ErrorsIgnoredNOLINT);
+    Writer.writeInt(Stats.ErrorsIgnoredNonUserCode);
+    Writer.writeInt(Stats.ErrorsIgnoredLineFilter);
+    Writer.writeInt(Stats.ErrorsIgnoredCheckedHeader);
+
+    Writer.writeInt(Errors.size());
+    for (const ClangTidyError &Error : Errors) {
+      Writer.writeString(Error.CheckName);
+      Writer.writeInt(Error.DiagLevel);
+      Writer.writeMessage(Error.Message);
+      Writer.writeInt(Error.Notes.size());
+      for (const ClangTidyMessage &Note : Error.Notes)
+        Writer.writeMessage(Note);
+      Writer.writeInt(Error.Fix.size());
+      for (const tooling::Replacement &Fix : Error.Fix) {
+        Writer.writeString(Fix.getFilePath());
+        Writer.writeInt(Fix.getOffset());
+        Writer.writeInt(Fix.getLength());
+        Writer.writeString(Fix.getReplacementText());
+      }
+    }
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      llvm::sys::fs::remove(TempPath);
+      return;
+    }
+  }
+  if (llvm::sys::fs::rename(TempPath, getEntryPath(Key)))
+    llvm::sys::fs::remove(TempPath);
+}
+
+} // namespace tidy
+} // namespace clang
@@ -0,0 +1,67 @@
+//===--- ClangTidyCache.h - clang-tidy --------------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_CLANG_TIDY_CACHE_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_CLANG_TIDY_CACHE_H
+
+#include "ClangTidyDiagnosticConsumer.h"
+#include "ClangTidyOptions.h"
+#include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/ADT/ArrayRef.h"
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace tidy {
+
+/// \brief On-disk cache of the results of clang-tidy runs on translation
+/// units.
+///
+/// An entry is looked up by a key derived from everything but the sources
+/// that determines the result: the tool version, the compile commands and the
+/// options. The entry lists the files the translation unit read along with a
+/// hash of their contents, and is only used if none of them changed.
+///
+/// Entries are written atomically, so the cache can be shared by concurrent
+/// runs and by the worker threads of a single run.
+class ClangTidyCache {
+public:
+  /// \brief Uses \p Directory to store entries, creating it if needed.
+  ClangTidyCache(StringRef Directory);
+
+  /// \brief Computes the key of the translation unit of \p FilePath.
+  static std::string
+  getKey(StringRef FilePath, ArrayRef<tooling::CompileCommand> Commands,
+         const ClangTidyOptions &Options,
+         const ClangTidyGlobalOptions &GlobalOptions);
+
+  /// \brief Reads the entry for \p Key.
+  ///
+  /// \returns \c true if the entry exists and none of the files read by the
+  /// translation unit changed since it was stored. \p Errors and \p Stats are
+  /// only modified in this case.
+  bool lookup(StringRef Key, std::vector<ClangTidyError> &Errors,
+              ClangTidyStats &Stats) const;
+
+  /// \brief Stores the \p Errors and \p Stats of the translation unit with
+  /// the given \p Key, which read \p ReadFiles.
+  void store(StringRef Key, ArrayRef<std::string> ReadFiles,
+             const std::vector<ClangTidyError> &Errors,
+             const ClangTidyStats &Stats) const;
+
+private:
+  std::string getEntryPath(StringRef Key) const;
+
+  std::string Directory;
+};
+
+} // end namespace tidy
+} // end namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_CLANG_TIDY_CACHE_H
@@ -22,11 +22,28 @@
 #include "clang/Basic/DiagnosticOptions.h"
 #include "clang/Frontend/DiagnosticRenderer.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
 #include <set>
 #include <tuple>
 using namespace clang;
 using namespace tidy;
 
+/// \brief Returns \p File made absolute. Relative names are resolved against
+/// the working directory of the file manager of \p SM, which isn't the one of
+/// the process when files are processed concurrently.
+static std::string getAbsolutePath(const SourceManager &SM, StringRef File) {
+  if (File.empty())
+    return File;
+  SmallString<128> Path(File);
+  SM.getFileManager().FixupRelativePath(Path);
+  llvm::sys::fs::make_absolute(Path);
+  return Path.str();
+}
+
 namespace {
 class ClangTidyDiagnosticRenderer : public DiagnosticRenderer {
 public:
@@ -78,7 +95,13 @@ protected:
       assert(Range.getBegin().isFileID() && Range.getEnd().isFileID() &&
              "Only file locations supported in fix-it hints.");
 
-      Error.Fix.insert(tooling::Replacement(SM, Range, FixIt.CodeToInsert));
+      tooling::Replacement Fix(SM, Range, FixIt.CodeToInsert);
+      if (!SM.getFileEntryForID(SM.getFileID(Range.getBegin())))
+        Error.Fix.insert(Fix);
+      else
+        Error.Fix.insert(tooling::Replacement(
+            getAbsolutePath(SM, Fix.getFilePath()), Fix.getOffset(),
+            Fix.getLength(), Fix.getReplacementText()));
     }
   }
 
@@ -111,7 +134,7 @@ ClangTidyMessage::ClangTidyMessage(StringRef Message,
                                    SourceLocation Loc)
     : Message(Message) {
   assert(Loc.isValid() && Loc.isFileID());
-  FilePath = Sources.getFilename(Loc);
+  FilePath = getAbsolutePath(Sources, Sources.getFilename(Loc));
   FileOffset = Sources.getFileOffset(Loc);
 }
 
@@ -119,6 +142,35 @@ ClangTidyError::ClangTidyError(StringRef CheckName,
                                ClangTidyError::Level DiagLevel)
     : CheckName(CheckName), DiagLevel(DiagLevel) {}
 
+static void hashString(llvm::MD5 &Hash, StringRef S) {
+  uint64_t Size = S.size();
+  Hash.update(ArrayRef<uint8_t>(reinterpret_cast<const uint8_t *>(&Size),
+                                sizeof(Size)));
+  Hash.update(S);
+}
+
+bool ClangTidyErrorSet::insert(const ClangTidyError &Error) {
+  const ClangTidyMessage &M = Error.Message;
+  llvm::MD5 Hash;
+  hashString(Hash, Error.CheckName);
+  hashString(Hash, M.FilePath);
+  uint64_t Offset = M.FileOffset;
+  Hash.update(ArrayRef<uint8_t>(reinterpret_cast<const uint8_t *>(&Offset),
+                                sizeof(Offset)));
+  hashString(Hash, M.Message);
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+
+  std::pair<uint64_t, uint64_t> Digest;
+  std::memcpy(&Digest.first, &Result[0], sizeof(Digest.first));
+  std::memcpy(&Digest.second, &Result[sizeof(Digest.first)],
+              sizeof(Digest.second));
+  if (Digests.count(Digest))
+    return false;
+  Digests.insert(Digest);
+  return true;
+}
+
 // Returns true if GlobList starts with the negative indicator ('-'), removes it
 // from the GlobList.
 static bool ConsumeNegativeIndicator(StringRef &GlobList) {
@@ -128,42 +180,134 @@ static bool ConsumeNegativeIndicator(StringRef &GlobList) {
   }
   return false;
 }
-// Converts first glob from the comma-separated list of globs to Regex and
-// removes it and the trailing comma from the GlobList.
-static llvm::Regex ConsumeGlob(StringRef &GlobList) {
+// Returns the first glob from the comma-separated list of globs and removes it
+// and the trailing comma from the GlobList.
+static StringRef ConsumeGlob(StringRef &GlobList) {
   StringRef Glob = GlobList.substr(0, GlobList.find(','));
   GlobList = GlobList.substr(Glob.size() + 1);
-  llvm::SmallString<128> RegexText("^");
-  StringRef MetaChars("()^$|*+?.[]\\{}");
-  for (char C : Glob) {
-    if (C == '*')
-      RegexText.push_back('.');
-    else if (MetaChars.find(C) != StringRef::npos)
-      RegexText.push_back('\\');
-    RegexText.push_back(C);
-  }
-  RegexText.push_back('$');
-  return llvm::Regex(RegexText);
+  return Glob;
 }
 
-GlobList::GlobList(StringRef Globs)
-    : Positive(!ConsumeNegativeIndicator(Globs)),
-      Regex(ConsumeGlob(Globs)),
-      NextGlob(Globs.empty() ? nullptr : new GlobList(Globs)) {}
+GlobList::GlobList(StringRef Globs) {
+  do {
+    Glob G;
+    G.Positive = !ConsumeNegativeIndicator(Globs);
+    StringRef Text = ConsumeGlob(Globs);
+    SmallVector<StringRef, 2> Segments;
+    Text.split(Segments, "*", /*MaxSplit=*/-1, /*KeepEmpty=*/true);
+    for (StringRef Segment : Segments)
+      G.Segments.push_back(Segment);
+
+    unsigned Index = Patterns.size();
+    if (G.Segments.size() == 1)
+      LiteralGlobs[Text] = Index;
+    else
+      WildcardGlobs.push_back(Index);
+    Patterns.push_back(std::move(G));
+  } while (!Globs.empty());
+}
 
-bool GlobList::contains(StringRef S, bool Contains) {
-  if (Regex.match(S))
-    Contains = Positive;
+bool GlobList::Glob::matches(StringRef S) const {
+  if (Segments.size() == 1)
+    return S == Segments.front();
+  // The first and the last segments are anchored, the ones in between are
+  // matched at their leftmost position.
+  StringRef Last = Segments.back();
+  if (!S.startswith(Segments.front()) || !S.endswith(Last) ||
+      S.size() < Segments.front().size() + Last.size())
+    return false;
+  S = S.substr(Segments.front().size(), S.size() - Segments.front().size() -
+                                            Last.size());
+  for (size_t I = 1, E = Segments.size() - 1; I != E; ++I) {
+    size_t Pos = S.find(Segments[I]);
+    if (Pos == StringRef::npos)
+      return false;
+    S = S.substr(Pos + Segments[I].size());
+  }
+  return true;
+}
 
-  if (NextGlob)
-    Contains = NextGlob->contains(S, Contains);
+bool GlobList::contains(StringRef S) {
+  auto Cached = Cache.find(S);
+  if (Cached != Cache.end())
+    return Cached->getValue();
+
+  // The last matching glob decides. Only the wildcard globs after the last
+  // matching literal one need to be tried.
+  int Match = -1;
+  auto Literal = LiteralGlobs.find(S);
+  if (Literal != LiteralGlobs.end())
+    Match = Literal->getValue();
+  for (auto I = WildcardGlobs.rbegin(), E = WildcardGlobs.rend();
+       I != E && static_cast<int>(*I) > Match; ++I) {
+    if (Patterns[*I].matches(S)) {
+      Match = *I;
+      break;
+    }
+  }
+
+  bool Contains = Match >= 0 && Patterns[Match].Positive;
+  Cache[S] = Contains;
   return Contains;
 }
 
+LineFilterIndex::LineFilterIndex(const std::vector<FileFilter> &LineFilter) {
+  for (unsigned I = 0, E = LineFilter.size(); I != E; ++I) {
+    const FileFilter &Filter = LineFilter[I];
+    // Later filters with the same name are never used.
+    if (Files.count(Filter.Name))
+      continue;
+    FileLines &Lines = Files[Filter.Name];
+    Lines.Index = I;
+    Lines.AllLines = Filter.LineRanges.empty();
+
+    std::vector<FileFilter::LineRange> Ranges;
+    for (const FileFilter::LineRange &Range : Filter.LineRanges)
+      if (Range.first <= Range.second)
+        Ranges.push_back(Range);
+    std::sort(Ranges.begin(), Ranges.end());
+    for (const FileFilter::LineRange &Range : Ranges) {
+      if (Lines.Ranges.empty() ||
+          (Lines.Ranges.back().second != std::numeric_limits<unsigned>::max() &&
+           Range.first > Lines.Ranges.back().second + 1))
+        Lines.Ranges.push_back(Range);
+      else
+        Lines.Ranges.back().second =
+            std::max(Lines.Ranges.back().second, Range.second);
+    }
+  }
+}
+
+const LineFilterIndex::FileLines *
+LineFilterIndex::lookup(StringRef FileName) const {
+  const FileLines *Result = nullptr;
+  for (size_t Start = 0, E = FileName.size(); Start <= E; ++Start) {
+    auto I = Files.find(FileName.substr(Start));
+    if (I != Files.end() && (!Result || I->second.Index < Result->Index))
+      Result = &I->second;
+  }
+  return Result;
+}
+
+bool LineFilterIndex::FileLines::contains(unsigned Line) const {
+  if (AllLines)
+    return true;
+  // The first range starting after Line.
+  auto I = std::upper_bound(
+      Ranges.begin(), Ranges.end(), Line,
+      [](unsigned Line, const FileFilter::LineRange &Range) {
+        return Line < Range.first;
+      });
+  return I != Ranges.begin() && Line <= std::prev(I)->second;
+}
+
 ClangTidyContext::ClangTidyContext(
     std::unique_ptr<ClangTidyOptionsProvider> OptionsProvider)
-    : DiagEngine(nullptr), OptionsProvider(std::move(OptionsProvider)),
-      Profile(nullptr) {
+    : ErrorSink(nullptr), DiagEngine(nullptr), DiagConsumer(nullptr),
+      OptionsProvider(std::move(OptionsProvider)), CurrentOptions(nullptr),
+      CurrentCheckedHeaders(nullptr), NolintSourceManager(nullptr),
+      TokenIndexSourceManager(nullptr), Profile(nullptr) {
+  SkipFilteredCode = getGlobalOptions().SkipFilteredCode;
   // Before the first translation unit we can get errors related to command-line
   // parsing, use empty string for the file name in this case.
   setCurrentFile("");
@@ -173,29 +317,116 @@ DiagnosticBuilder ClangTidyContext::diag(
     StringRef CheckName, SourceLocation Loc, StringRef Description,
     DiagnosticIDs::Level Level /* = DiagnosticIDs::Warning*/) {
   assert(Loc.isValid());
-  bool Invalid;
-  const char *CharacterData =
-      DiagEngine->getSourceManager().getCharacterData(Loc, &Invalid);
-  if (!Invalid) {
-    const char *P = CharacterData;
-    while (*P != '\0' && *P != '\r' && *P != '\n')
-      ++P;
-    StringRef RestOfLine(CharacterData, P - CharacterData + 1);
-    // FIXME: Handle /\bNOLINT\b(\([^)]*\))?/ as cpplint.py does.
-    if (RestOfLine.find("NOLINT") != StringRef::npos) {
-      Level = DiagnosticIDs::Ignored;
-      ++Stats.ErrorsIgnoredNOLINT;
-    }
+  if (isSuppressedByNolint(CheckName, Loc)) {
+    Level = DiagnosticIDs::Ignored;
+    ++Stats.ErrorsIgnoredNOLINT;
   }
-  unsigned ID = DiagEngine->getDiagnosticIDs()->getCustomDiagID(
-      Level, (Description + " [" + CheckName + "]").str());
-  if (CheckNamesByDiagnosticID.count(ID) == 0)
+  return DiagEngine->Report(Loc,
+                            getCustomDiagID(CheckName, Description, Level));
+}
+
+unsigned ClangTidyContext::getCustomDiagID(StringRef CheckName,
+                                           StringRef Description,
+                                           DiagnosticIDs::Level Level) {
+  SmallString<128> Key;
+  Key.push_back(static_cast<char>(Level));
+  Key += CheckName;
+  Key.push_back('\0');
+  Key += Description;
+  unsigned &ID = CustomDiagIDs[Key];
+  // Custom IDs are allocated after the builtin ones, so 0 is never used.
+  if (ID == 0) {
+    ID = DiagEngine->getDiagnosticIDs()->getCustomDiagID(
+        Level, (Description + " [" + CheckName + "]").str());
     CheckNamesByDiagnosticID.insert(std::make_pair(ID, CheckName.str()));
-  return DiagEngine->Report(Loc, ID);
+  }
+  return ID;
+}
+
+const TokenIndex &ClangTidyContext::getTokenIndex(const SourceManager &SM,
+                                                  FileID FID,
+                                                  const LangOptions &LangOpts) {
+  if (&SM != TokenIndexSourceManager) {
+    TokenIndexByFile.clear();
+    TokenIndexSourceManager = &SM;
+  }
+  std::unique_ptr<TokenIndex> &Index = TokenIndexByFile[FID];
+  if (!Index)
+    Index.reset(new TokenIndex(SM, FID, LangOpts));
+  return *Index;
+}
+
+const ClangTidyContext::NolintLines &
+ClangTidyContext::getNolintLines(const SourceManager &SM, FileID FID) {
+  if (&SM != NolintSourceManager) {
+    NolintLinesByFile.clear();
+    NolintSourceManager = &SM;
+  }
+  auto Cached = NolintLinesByFile.find(FID);
+  if (Cached != NolintLinesByFile.end())
+    return Cached->second;
+
+  NolintLines &Lines = NolintLinesByFile[FID];
+  bool Invalid = false;
+  StringRef Buffer = SM.getBufferData(FID, &Invalid);
+  if (Invalid)
+    return Lines;
+  const StringRef Marker = "NOLINT";
+  for (size_t Pos = Buffer.find(Marker); Pos != StringRef::npos;
+       Pos = Buffer.find(Marker, Pos + Marker.size())) {
+    NolintComment Comment;
+    Comment.Offset = Pos;
+    // NOLINT(check1, check2) only applies to the listed checks. A list that
+    // isn't closed on the same line or contains '*' applies to all of them.
+    StringRef Rest = Buffer.substr(Pos + Marker.size());
+    if (Rest.startswith("(")) {
+      StringRef List = Rest.substr(1, Rest.find_first_of(")\r\n") - 1);
+      if (List.size() + 1 < Rest.size() && Rest[List.size() + 1] == ')') {
+        SmallVector<StringRef, 4> Names;
+        List.split(Names, ",", /*MaxSplit=*/-1, /*KeepEmpty=*/false);
+        for (StringRef Name : Names) {
+          Name = Name.trim();
+          if (Name == "*") {
+            Comment.Checks.clear();
+            break;
+          }
+          if (!Name.empty())
+            Comment.Checks.push_back(Name);
+        }
+      }
+    }
+    Lines[SM.getLineNumber(FID, Pos)].push_back(Comment);
+  }
+  return Lines;
+}
+
+bool ClangTidyContext::isSuppressedByNolint(StringRef CheckName,
+                                            SourceLocation Loc) {
+  const SourceManager &SM = DiagEngine->getSourceManager();
+  std::pair<FileID, unsigned> Spelling = SM.getDecomposedSpellingLoc(Loc);
+  const NolintLines &Lines = getNolintLines(SM, Spelling.first);
+  if (Lines.empty())
+    return false;
+  auto I = Lines.find(SM.getLineNumber(Spelling.first, Spelling.second));
+  if (I == Lines.end())
+    return false;
+  for (const NolintComment &Comment : I->second) {
+    // Only comments after the location count, as they did when the rest of
+    // the line was searched.
+    if (Comment.Offset < Spelling.second)
+      continue;
+    if (Comment.Checks.empty() ||
+        std::find(Comment.Checks.begin(), Comment.Checks.end(), CheckName) !=
+            Comment.Checks.end())
+      return true;
+  }
+  return false;
 }
 
 void ClangTidyContext::setDiagnosticsEngine(DiagnosticsEngine *Engine) {
   DiagEngine = Engine;
+  // The IDs belong to the DiagnosticIDs of the engine.
+  CustomDiagIDs.clear();
 }
 
 void ClangTidyContext::setSourceManager(SourceManager *SourceMgr) {
@@ -204,10 +435,34 @@ void ClangTidyContext::setSourceManager(SourceManager *SourceMgr) {
 
 void ClangTidyContext::setCurrentFile(StringRef File) {
   CurrentFile = File;
+  // A new SourceManager may reuse the address of the previous one.
+  NolintLinesByFile.clear();
+  NolintSourceManager = nullptr;
+  TokenIndexByFile.clear();
+  TokenIndexSourceManager = nullptr;
+  OptionsProvider->invalidateChangedConfigFiles(CurrentFile);
+  CurrentOptions = &internOptions(OptionsProvider->getOptions(CurrentFile));
+  CurrentCheckedHeaders = getGlobalOptions().SkipCheckedHeaders
+                              ? &CurrentOptions->CheckedHeaders
+                              : nullptr;
+}
+
+ClangTidyContext::InternedOptions &
+ClangTidyContext::internOptions(const ClangTidyOptions &Options) {
+  InternedOptions *&Interned = InternedOptionsByProvided[&Options];
+  if (Interned)
+    return *Interned;
+
   // Safeguard against options with unset values.
-  CurrentOptions = ClangTidyOptions::getDefaults().mergeWith(
-      OptionsProvider->getOptions(CurrentFile));
-  CheckFilter.reset(new GlobList(*getOptions().Checks));
+  ClangTidyOptions Merged = ClangTidyOptions::getDefaults().mergeWith(Options);
+  // SystemHeaders isn't part of the YAML form.
+  std::string Key = configurationAsText(Merged);
+  Key += *Merged.SystemHeaders ? "\nSystemHeaders: true" : "";
+  std::unique_ptr<InternedOptions> &Slot = InternedOptionsByText[Key];
+  if (!Slot)
+    Slot.reset(new InternedOptions(std::move(Merged)));
+  Interned = Slot.get();
+  return *Interned;
 }
 
 void ClangTidyContext::setASTContext(ASTContext *Context) {
@@ -219,7 +474,7 @@ const ClangTidyGlobalOptions &ClangTidyContext::getGlobalOptions() const {
 }
 
 const ClangTidyOptions &ClangTidyContext::getOptions() const {
-  return CurrentOptions;
+  return CurrentOptions->Options;
 }
 
 void ClangTidyContext::setCheckProfileData(ProfileData *P) {
@@ -227,15 +482,46 @@ void ClangTidyContext::setCheckProfileData(ProfileData *P) {
 }
 
 GlobList &ClangTidyContext::getChecksFilter() {
-  assert(CheckFilter != nullptr);
-  return *CheckFilter;
+  return CurrentOptions->CheckFilter;
 }
 
 /// \brief Store a \c ClangTidyError.
 void ClangTidyContext::storeError(const ClangTidyError &Error) {
+  // Each translation unit including a header reports the same errors in it.
+  // Keep the first one only.
+  if (!ReportedErrors.insert(Error)) {
+    --Stats.ErrorsDisplayed;
+    return;
+  }
   Errors.push_back(Error);
 }
 
+void ClangTidyContext::flushErrors() {
+  if (!ErrorSink || Errors.empty())
+    return;
+  ErrorSink->handleErrors(CurrentFile, Errors);
+  Errors.clear();
+}
+
+void ClangTidyContext::resetReportedErrors() {
+  ReportedErrors.clear();
+  for (auto &Interned : InternedOptionsByText)
+    Interned.getValue()->CheckedHeaders.clear();
+}
+
+bool ClangTidyContext::isCheckedHeader(StringRef FileName) const {
+  return CurrentCheckedHeaders && CurrentCheckedHeaders->count(FileName);
+}
+
+void ClangTidyContext::addCheckedHeader(StringRef FileName) {
+  assert(CurrentCheckedHeaders);
+  CurrentCheckedHeaders->insert(FileName);
+}
+
+bool ClangTidyContext::canReportAt(SourceLocation Loc) {
+  return !DiagConsumer || DiagConsumer->canReport(Loc);
+}
+
 StringRef ClangTidyContext::getCheckName(unsigned DiagnosticID) const {
   llvm::DenseMap<unsigned, std::string>::const_iterator I =
       CheckNamesByDiagnosticID.find(DiagnosticID);
@@ -246,16 +532,21 @@ StringRef ClangTidyContext::getCheckName(unsigned DiagnosticID) const {
 
 ClangTidyDiagnosticConsumer::ClangTidyDiagnosticConsumer(ClangTidyContext &Ctx)
     : Context(Ctx), LastErrorRelatesToUserCode(false),
-      LastErrorPassesLineFilter(false) {
+      LastErrorPassesLineFilter(false), LastErrorSkipped(false) {
   IntrusiveRefCntPtr<DiagnosticOptions> DiagOpts = new DiagnosticOptions();
   Diags.reset(new DiagnosticsEngine(
       IntrusiveRefCntPtr<DiagnosticIDs>(new DiagnosticIDs), &*DiagOpts, this,
       /*ShouldOwnClient=*/false));
   Context.setDiagnosticsEngine(Diags.get());
+  Context.DiagConsumer = this;
 }
 
 void ClangTidyDiagnosticConsumer::finalizeLastError() {
-  if (!Errors.empty()) {
+  if (LastErrorSkipped) {
+    // The last diagnostic wasn't added to Errors, Errors.back() has already
+    // been finalized.
+    LastErrorSkipped = false;
+  } else if (!Errors.empty()) {
     ClangTidyError &Error = Errors.back();
     if (!Context.getChecksFilter().contains(Error.CheckName) &&
         Error.DiagLevel != ClangTidyError::Error) {
@@ -278,10 +569,20 @@ void ClangTidyDiagnosticConsumer::finalizeLastError() {
 void ClangTidyDiagnosticConsumer::HandleDiagnostic(
     DiagnosticsEngine::Level DiagLevel, const Diagnostic &Info) {
   if (DiagLevel == DiagnosticsEngine::Note) {
+    if (LastErrorSkipped)
+      return;
     assert(!Errors.empty() &&
            "A diagnostic note can only be appended to a message.");
   } else {
     finalizeLastError();
+    // Warnings in a header checked by an earlier translation unit have already
+    // been reported, don't spend time on converting them.
+    if (DiagLevel == DiagnosticsEngine::Warning &&
+        isInCheckedHeader(Info.getLocation())) {
+      ++Context.Stats.ErrorsIgnoredCheckedHeader;
+      LastErrorSkipped = true;
+      return;
+    }
     StringRef WarningOption =
         Context.DiagEngine->getDiagnosticIDs()->getWarningOptionForDiag(
             Info.getID());
@@ -338,24 +639,79 @@ void ClangTidyDiagnosticConsumer::BeginSourceFile(const LangOptions &LangOpts,
   // Before the first translation unit we don't need HeaderFilter, as we
   // shouldn't get valid source locations in diagnostics.
   HeaderFilter.reset(new llvm::Regex(*Context.getOptions().HeaderFilterRegex));
+  Verdicts.clear();
+  if (!LineFilter && !Context.getGlobalOptions().LineFilter.empty())
+    LineFilter.reset(
+        new LineFilterIndex(Context.getGlobalOptions().LineFilter));
 }
 
-bool ClangTidyDiagnosticConsumer::passesLineFilter(StringRef FileName,
-                                                   unsigned LineNumber) const {
-  if (Context.getGlobalOptions().LineFilter.empty())
-    return true;
-  for (const FileFilter& Filter : Context.getGlobalOptions().LineFilter) {
-    if (FileName.endswith(Filter.Name)) {
-      if (Filter.LineRanges.empty())
-        return true;
-      for (const FileFilter::LineRange &Range : Filter.LineRanges) {
-        if (Range.first <= LineNumber && LineNumber <= Range.second)
-          return true;
-      }
-      return false;
-    }
+void ClangTidyDiagnosticConsumer::EndSourceFile() {
+  if (!Context.CurrentCheckedHeaders || !Diags->hasSourceManager())
+    return;
+  const SourceManager &Sources = Diags->getSourceManager();
+  const FileEntry *MainFile =
+      Sources.getFileEntryForID(Sources.getMainFileID());
+  for (auto I = Sources.fileinfo_begin(), E = Sources.fileinfo_end(); I != E;
+       ++I) {
+    const FileEntry *File = I->first;
+    // Warnings in headers not matching HeaderFilter are never reported, there
+    // is nothing to skip for them.
+    if (File != MainFile && HeaderFilter &&
+        HeaderFilter->match(File->getName()))
+      Context.addCheckedHeader(File->getName());
   }
-  return false;
+}
+
+const ClangTidyDiagnosticConsumer::FilterVerdict &
+ClangTidyDiagnosticConsumer::getVerdict(FileID FID) {
+  auto Cached = Verdicts.find(FID);
+  if (Cached != Verdicts.end())
+    return Cached->second;
+
+  FilterVerdict &Verdict = Verdicts[FID];
+  const SourceManager &Sources = Diags->getSourceManager();
+  const FileEntry *File = Sources.getFileEntryForID(FID);
+  Verdict.HasFile = File != nullptr;
+  if (!File)
+    return Verdict;
+
+  const SrcMgr::SLocEntry &Entry = Sources.getSLocEntry(FID);
+  Verdict.PerLocation = Entry.isFile() && Entry.getFile().hasLineDirectives();
+  Verdict.SystemHeader =
+      !*Context.getOptions().SystemHeaders &&
+      Sources.isInSystemHeader(Sources.getLocForStartOfFile(FID));
+  Verdict.MainFile = FID == Sources.getMainFileID();
+  assert(Verdict.MainFile || HeaderFilter != nullptr);
+  Verdict.MatchesHeaderFilter =
+      !Verdict.MainFile && HeaderFilter->match(File->getName());
+  Verdict.CheckedHeader = Context.CurrentCheckedHeaders && !Verdict.MainFile &&
+                          Context.isCheckedHeader(File->getName());
+  if (LineFilter)
+    Verdict.Lines = LineFilter->lookup(File->getName());
+  return Verdict;
+}
+
+bool ClangTidyDiagnosticConsumer::isInCheckedHeader(SourceLocation Location) {
+  if (!Context.CurrentCheckedHeaders || !Location.isValid())
+    return false;
+  const SourceManager &Sources = Diags->getSourceManager();
+  return getVerdict(Sources.getDecomposedExpansionLoc(Location).first)
+      .CheckedHeader;
+}
+
+bool ClangTidyDiagnosticConsumer::canReport(SourceLocation Location) {
+  if (!Location.isValid())
+    return true;
+  const SourceManager &Sources = Diags->getSourceManager();
+  const FilterVerdict &Verdict =
+      getVerdict(Sources.getDecomposedExpansionLoc(Location).first);
+  if (!Verdict.HasFile || Verdict.PerLocation)
+    return true;
+  if (Verdict.SystemHeader || Verdict.CheckedHeader)
+    return false;
+  if (!Verdict.MainFile && !Verdict.MatchesHeaderFilter)
+    return false;
+  return !LineFilter || Verdict.Lines;
 }
 
 void ClangTidyDiagnosticConsumer::checkFilters(SourceLocation Location) {
@@ -366,35 +722,42 @@ void ClangTidyDiagnosticConsumer::checkFilters(SourceLocation Location) {
     return;
   }
 
-  const SourceManager &Sources = Diags->getSourceManager();
-  if (!*Context.getOptions().SystemHeaders &&
-      Sources.isInSystemHeader(Location))
-    return;
-
   // FIXME: We start with a conservative approach here, but the actual type of
   // location needed depends on the check (in particular, where this check wants
   // to apply fixes).
-  FileID FID = Sources.getDecomposedExpansionLoc(Location).first;
-  const FileEntry *File = Sources.getFileEntryForID(FID);
+  const SourceManager &Sources = Diags->getSourceManager();
+  const FilterVerdict &Verdict =
+      getVerdict(Sources.getDecomposedExpansionLoc(Location).first);
 
   // -DMACRO definitions on the command line have locations in a virtual buffer
   // that doesn't have a FileEntry. Don't skip these as well.
-  if (!File) {
+  if (!Verdict.HasFile) {
     LastErrorRelatesToUserCode = true;
     LastErrorPassesLineFilter = true;
     return;
   }
 
-  StringRef FileName(File->getName());
-  assert(LastErrorRelatesToUserCode || Sources.isInMainFile(Location) ||
-         HeaderFilter != nullptr);
-  LastErrorRelatesToUserCode = LastErrorRelatesToUserCode ||
-                               Sources.isInMainFile(Location) ||
-                               HeaderFilter->match(FileName);
+  // Line directives can change whether a location is in a system header or in
+  // the main file.
+  if (Verdict.PerLocation) {
+    if (!*Context.getOptions().SystemHeaders &&
+        Sources.isInSystemHeader(Location))
+      return;
+    LastErrorRelatesToUserCode = LastErrorRelatesToUserCode ||
+                                 Sources.isInMainFile(Location) ||
+                                 Verdict.MatchesHeaderFilter;
+  } else {
+    if (Verdict.SystemHeader)
+      return;
+    LastErrorRelatesToUserCode = LastErrorRelatesToUserCode ||
+                                 Verdict.MainFile ||
+                                 Verdict.MatchesHeaderFilter;
+  }
 
-  unsigned LineNumber = Sources.getExpansionLineNumber(Location);
   LastErrorPassesLineFilter =
-      LastErrorPassesLineFilter || passesLineFilter(FileName, LineNumber);
+      LastErrorPassesLineFilter || !LineFilter ||
+      (Verdict.Lines &&
+       Verdict.Lines->contains(Sources.getExpansionLineNumber(Location)));
 }
 
 namespace {
@@ -419,4 +782,5 @@ void ClangTidyDiagnosticConsumer::finish() {
   for (const ClangTidyError *Error : UniqueErrors)
     Context.storeError(*Error);
   Errors.clear();
+  Context.flushErrors();
 }
@@ -11,11 +11,14 @@
 #define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_CLANG_TIDY_DIAGNOSTIC_CONSUMER_H
 
 #include "ClangTidyOptions.h"
+#include "ClangTidyTokenIndex.h"
 #include "clang/Basic/Diagnostic.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Tooling/Refactoring.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/Regex.h"
 #include "llvm/Support/Timer.h"
 
@@ -67,9 +70,47 @@ struct ClangTidyError {
   Level DiagLevel;
 };
 
+/// \brief Set of errors identified by check name, location and message.
+///
+/// Used to report an error only once when it is produced by several
+/// translation units, e.g. in a header included from all of them. Only the
+/// MD5 of these fields is kept for each error.
+class ClangTidyErrorSet {
+public:
+  /// \brief Adds \p Error to the set. Returns \c false if an identical error
+  /// is already there.
+  bool insert(const ClangTidyError &Error);
+
+  void clear() { Digests.clear(); }
+
+private:
+  llvm::DenseSet<std::pair<uint64_t, uint64_t>> Digests;
+};
+
+/// \brief Receives the errors of a clang-tidy run as soon as each translation
+/// unit is processed, so that they don't have to be kept until the end.
+class ClangTidyErrorSink {
+public:
+  virtual ~ClangTidyErrorSink() {}
+
+  /// \brief Receives the errors found in the translation units of
+  /// \p MainFile.
+  ///
+  /// Errors already received from another translation unit are not repeated.
+  /// Calls are never concurrent.
+  virtual void handleErrors(StringRef MainFile,
+                            ArrayRef<ClangTidyError> Errors) = 0;
+
+  /// \brief Called once after the last translation unit.
+  virtual void finish() {}
+};
+
 /// \brief Read-only set of strings represented as a list of positive and
 /// negative globs. Positive globs add all matched strings to the set, negative
 /// globs remove them in the order of appearance in the list.
+///
+/// Globs without '*' are looked up in a map, the others are matched from the
+/// last one backwards until the result is known. Results are cached per string.
 class GlobList {
 public:
   /// \brief \p GlobList is a comma-separated list of globs (only '*'
@@ -78,40 +119,132 @@ public:
 
   /// \brief Returns \c true if the pattern matches \p S. The result is the last
   /// matching glob's Positive flag.
-  bool contains(StringRef S) { return contains(S, false); }
+  bool contains(StringRef S);
 
 private:
-  bool contains(StringRef S, bool Contains);
+  /// \brief A glob split at its '*' metacharacters.
+  struct Glob {
+    bool matches(StringRef S) const;
+
+    bool Positive;
+    /// \brief The text between the '*'s. A glob without '*' has a single
+    /// segment.
+    SmallVector<std::string, 2> Segments;
+  };
 
-  bool Positive;
-  llvm::Regex Regex;
-  std::unique_ptr<GlobList> NextGlob;
+  std::vector<Glob> Patterns;
+  /// \brief Index of the last glob without '*' for each such glob text.
+  llvm::StringMap<unsigned> LiteralGlobs;
+  /// \brief Indices of the globs with '*' in the order of appearance.
+  std::vector<unsigned> WildcardGlobs;
+  llvm::StringMap<bool> Cache;
+};
+
+/// \brief \c ClangTidyGlobalOptions::LineFilter compiled for lookups.
+///
+/// A file is filtered by the first \c FileFilter whose name is a suffix of the
+/// file name. Filters are indexed by name, and their line ranges are sorted and
+/// merged so that a line is looked up with a binary search.
+class LineFilterIndex {
+public:
+  /// \brief The lines of a file for which warnings are shown.
+  class FileLines {
+  public:
+    bool contains(unsigned Line) const;
+
+  private:
+    friend class LineFilterIndex;
+
+    /// \brief Position of the filter in the list.
+    unsigned Index;
+    /// \brief Set if the filter has no ranges.
+    bool AllLines;
+    /// \brief Sorted, disjoint and non-adjacent ranges.
+    std::vector<FileFilter::LineRange> Ranges;
+  };
+
+  LineFilterIndex(const std::vector<FileFilter> &LineFilter);
+
+  /// \brief Returns the lines of \p FileName for which warnings are shown, or
+  /// null if no filter applies to the file.
+  const FileLines *lookup(StringRef FileName) const;
+
+private:
+  /// \brief The first filter with each name.
+  llvm::StringMap<FileLines> Files;
 };
 
 /// \brief Contains displayed and ignored diagnostic counters for a ClangTidy
-/// run.
+/// run, and the result cache and preamble counters if these are used.
 struct ClangTidyStats {
   ClangTidyStats()
       : ErrorsDisplayed(0), ErrorsIgnoredCheckFilter(0), ErrorsIgnoredNOLINT(0),
-        ErrorsIgnoredNonUserCode(0), ErrorsIgnoredLineFilter(0) {}
+        ErrorsIgnoredNonUserCode(0), ErrorsIgnoredLineFilter(0),
+        ErrorsIgnoredCheckedHeader(0), CacheHits(0), CacheMisses(0),
+        PreamblesBuilt(0), PreamblesReused(0) {}
 
   unsigned ErrorsDisplayed;
   unsigned ErrorsIgnoredCheckFilter;
   unsigned ErrorsIgnoredNOLINT;
   unsigned ErrorsIgnoredNonUserCode;
   unsigned ErrorsIgnoredLineFilter;
+  /// \brief Warnings skipped in headers checked by an earlier translation
+  /// unit, see \c ClangTidyGlobalOptions::SkipCheckedHeaders.
+  unsigned ErrorsIgnoredCheckedHeader;
+
+  /// \brief Translation units whose results were read from the cache.
+  unsigned CacheHits;
+  /// \brief Translation units that had to be processed with a cache enabled.
+  unsigned CacheMisses;
+
+  /// \brief PCHs built for preambles shared by several translation units.
+  unsigned PreamblesBuilt;
+  /// \brief Translation units that used a PCH instead of parsing their
+  /// preamble.
+  unsigned PreamblesReused;
 
   unsigned errorsIgnored() const {
     return ErrorsIgnoredNOLINT + ErrorsIgnoredCheckFilter +
-           ErrorsIgnoredNonUserCode + ErrorsIgnoredLineFilter;
+           ErrorsIgnoredNonUserCode + ErrorsIgnoredLineFilter +
+           ErrorsIgnoredCheckedHeader;
   }
 };
 
+/// \brief Profile of a single translation unit.
+struct TranslationUnitProfile {
+  TranslationUnitProfile() : Start(0), ProcessPeakRSSAfter(0) {}
+
+  std::string File;
+  /// \brief Wall time in seconds at which the translation unit started being
+  /// processed.
+  double Start;
+  /// \brief Time spent in the frontend before the AST was complete.
+  llvm::TimeRecord Parse;
+  /// \brief Time spent in the matchers of all checks.
+  llvm::TimeRecord Matchers;
+  /// \brief Time spent in the static analyzer.
+  llvm::TimeRecord Analyzer;
+  /// \brief Time spent in the matchers of each check.
+  llvm::StringMap<llvm::TimeRecord> Checks;
+  /// \brief Peak resident set size of the whole process in bytes once the
+  /// translation unit was processed, or 0 if unknown.
+  ///
+  /// This is a process-wide high-water mark, not the memory used by this
+  /// translation unit: it never decreases and, with -j, includes the memory
+  /// of the translation units processed concurrently.
+  uint64_t ProcessPeakRSSAfter;
+};
+
 /// \brief Container for clang-tidy profiling data.
 struct ProfileData {
+  /// \brief Time spent in the matchers of each check over all translation
+  /// units.
   llvm::StringMap<llvm::TimeRecord> Records;
+  std::vector<TranslationUnitProfile> TranslationUnits;
 };
 
+class ClangTidyDiagnosticConsumer;
+
 /// \brief Every \c ClangTidyCheck reports errors through a \c DiagnosticEngine
 /// provided by this context.
 ///
@@ -159,6 +292,19 @@ public:
   /// \brief Returns options for \c CurrentFile.
   const ClangTidyOptions &getOptions() const;
 
+  /// \brief Returns \c true if location-local checks shouldn't look at nodes
+  /// whose warnings are never reported
+  /// (\c ClangTidyGlobalOptions::SkipFilteredCode).
+  bool skipsFilteredCode() const { return SkipFilteredCode; }
+
+  /// \brief Returns \c false if a warning at \p Loc is never reported.
+  bool canReportAt(SourceLocation Loc);
+
+  /// \brief Returns the raw tokens of \p FID, lexing the file the first time
+  /// it is queried in a translation unit.
+  const TokenIndex &getTokenIndex(const SourceManager &SM, FileID FID,
+                                  const LangOptions &LangOpts);
+
   /// \brief Returns \c ClangTidyStats containing issued and ignored diagnostic
   /// counters.
   const ClangTidyStats &getStats() const { return Stats; }
@@ -169,6 +315,17 @@ public:
   /// \brief Clears collected errors.
   void clearErrors() { Errors.clear(); }
 
+  /// \brief Passes the errors of each translation unit to \p Sink as soon as
+  /// they are stored, instead of collecting them.
+  void setErrorSink(ClangTidyErrorSink *Sink) { ErrorSink = Sink; }
+
+  /// \brief Forgets the errors and headers reported so far, so that the next
+  /// translation unit stores all of its errors again.
+  ///
+  /// Errors repeated by several translation units are otherwise stored only
+  /// once.
+  void resetReportedErrors();
+
   /// \brief Set the output struct for profile data.
   ///
   /// Setting a non-null pointer here will enable profile collection in
@@ -177,27 +334,107 @@ public:
   ProfileData* getCheckProfileData() const { return Profile; }
 
 private:
-  // Calls setDiagnosticsEngine() and storeError().
+  // Calls setDiagnosticsEngine(), storeError(), flushErrors() and the checked
+  // headers accessors, and sets DiagConsumer.
   friend class ClangTidyDiagnosticConsumer;
 
   /// \brief Sets the \c DiagnosticsEngine so that Diagnostics can be generated
   /// correctly.
   void setDiagnosticsEngine(DiagnosticsEngine *Engine);
 
+  /// \brief A NOLINT comment.
+  struct NolintComment {
+    /// \brief Offset of the comment in its file.
+    unsigned Offset;
+    /// \brief The checks listed in NOLINT(...). Empty if the comment applies
+    /// to all checks.
+    SmallVector<StringRef, 2> Checks;
+  };
+
+  /// \brief NOLINT comments of a file by line number.
+  typedef llvm::DenseMap<unsigned, SmallVector<NolintComment, 1>> NolintLines;
+
+  /// \brief Returns the NOLINT comments of \p FID, scanning the file the first
+  /// time it is queried in a translation unit.
+  const NolintLines &getNolintLines(const SourceManager &SM, FileID FID);
+
+  /// \brief Returns \c true if a NOLINT comment applying to \p CheckName
+  /// follows \p Loc on its line.
+  bool isSuppressedByNolint(StringRef CheckName, SourceLocation Loc);
+
+  /// \brief Returns the custom diagnostic ID of \p Description reported by
+  /// \p CheckName at \p Level, creating it the first time.
+  unsigned getCustomDiagID(StringRef CheckName, StringRef Description,
+                           DiagnosticIDs::Level Level);
+
   /// \brief Store an \p Error.
   void storeError(const ClangTidyError &Error);
 
+  /// \brief Passes the stored errors to the error sink, if there is one.
+  void flushErrors();
+
+  /// \brief Returns \c true if \p FileName was checked by an earlier
+  /// translation unit with the options of \c CurrentFile and
+  /// \c ClangTidyGlobalOptions::SkipCheckedHeaders is set.
+  bool isCheckedHeader(StringRef FileName) const;
+
+  /// \brief Records that \p FileName was checked with the options of
+  /// \c CurrentFile.
+  void addCheckedHeader(StringRef FileName);
+
+  /// \brief Options of translation units merged with the defaults, and what
+  /// is derived from them. Shared by all translation units with the same
+  /// options.
+  struct InternedOptions {
+    explicit InternedOptions(ClangTidyOptions MergedOptions)
+        : Options(std::move(MergedOptions)), CheckFilter(*Options.Checks) {}
+
+    const ClangTidyOptions Options;
+    GlobList CheckFilter;
+    /// \brief Headers checked with these options, if
+    /// \c ClangTidyGlobalOptions::SkipCheckedHeaders is set.
+    llvm::StringSet<> CheckedHeaders;
+  };
+
+  /// \brief Returns the interned options for \p Options returned by the
+  /// \c OptionsProvider.
+  InternedOptions &internOptions(const ClangTidyOptions &Options);
+
   std::vector<ClangTidyError> Errors;
+  ClangTidyErrorSet ReportedErrors;
+  ClangTidyErrorSink *ErrorSink;
   DiagnosticsEngine *DiagEngine;
+  ClangTidyDiagnosticConsumer *DiagConsumer;
   std::unique_ptr<ClangTidyOptionsProvider> OptionsProvider;
+  bool SkipFilteredCode;
 
   std::string CurrentFile;
-  ClangTidyOptions CurrentOptions;
-  std::unique_ptr<GlobList> CheckFilter;
+  InternedOptions *CurrentOptions;
+  // Interned options by their YAML form, and by the address of the options
+  // returned by OptionsProvider they were merged from.
+  llvm::StringMap<std::unique_ptr<InternedOptions>> InternedOptionsByText;
+  llvm::DenseMap<const ClangTidyOptions *, InternedOptions *>
+      InternedOptionsByProvided;
+
+  // The checked headers of CurrentOptions. Null unless SkipCheckedHeaders is
+  // set.
+  llvm::StringSet<> *CurrentCheckedHeaders;
 
   ClangTidyStats Stats;
 
   llvm::DenseMap<unsigned, std::string> CheckNamesByDiagnosticID;
+  // Custom diagnostic IDs by level, check name and description.
+  llvm::StringMap<unsigned> CustomDiagIDs;
+
+  // NOLINT comments of the files of the current translation unit, which uses
+  // NolintSourceManager.
+  llvm::DenseMap<FileID, NolintLines> NolintLinesByFile;
+  const SourceManager *NolintSourceManager;
+
+  // Raw tokens of the files of the current translation unit, which uses
+  // TokenIndexSourceManager.
+  llvm::DenseMap<FileID, std::unique_ptr<TokenIndex>> TokenIndexByFile;
+  const SourceManager *TokenIndexSourceManager;
 
   ProfileData *Profile;
 };
@@ -221,23 +458,67 @@ public:
   void BeginSourceFile(const LangOptions &LangOpts,
                        const Preprocessor *PP) override;
 
+  /// \brief Records the headers checked in this translation unit, if
+  /// \c ClangTidyGlobalOptions::SkipCheckedHeaders is set.
+  void EndSourceFile() override;
+
   /// \brief Flushes the internal diagnostics buffer to the ClangTidyContext.
   void finish() override;
 
+  /// \brief Returns \c false if a warning at \p Location is never reported,
+  /// as it is in a file excluded by the header, line or checked headers
+  /// filters.
+  bool canReport(SourceLocation Location);
+
 private:
   void finalizeLastError();
 
+  /// \brief Filtering decisions for the locations of a file, which don't
+  /// change within a translation unit.
+  struct FilterVerdict {
+    FilterVerdict()
+        : HasFile(false), PerLocation(false), SystemHeader(false),
+          MainFile(false), MatchesHeaderFilter(false), CheckedHeader(false),
+          Lines(nullptr) {}
+
+    /// \brief Unset for virtual buffers, e.g. command line macros.
+    bool HasFile;
+    /// \brief The file has line directives, which can change \c SystemHeader
+    /// and \c MainFile within it.
+    bool PerLocation;
+    /// \brief The file is a system header and these aren't reported.
+    bool SystemHeader;
+    bool MainFile;
+    bool MatchesHeaderFilter;
+    /// \brief The header was checked by an earlier translation unit.
+    bool CheckedHeader;
+    /// \brief The lines shown by the line filter, if there is one.
+    const LineFilterIndex::FileLines *Lines;
+  };
+
+  const FilterVerdict &getVerdict(FileID FID);
+
+  /// \brief Returns \c true if \p Location is in a header that was checked by
+  /// an earlier translation unit.
+  bool isInCheckedHeader(SourceLocation Location);
+
   /// \brief Updates \c LastErrorRelatesToUserCode and LastErrorPassesLineFilter
   /// according to the diagnostic \p Location.
   void checkFilters(SourceLocation Location);
-  bool passesLineFilter(StringRef FileName, unsigned LineNumber) const;
 
   ClangTidyContext &Context;
   std::unique_ptr<DiagnosticsEngine> Diags;
   SmallVector<ClangTidyError, 8> Errors;
   std::unique_ptr<llvm::Regex> HeaderFilter;
+  // Built by the first BeginSourceFile() if there is a line filter.
+  std::unique_ptr<LineFilterIndex> LineFilter;
+  // Filtering decisions for the files of the current translation unit.
+  llvm::DenseMap<FileID, FilterVerdict> Verdicts;
   bool LastErrorRelatesToUserCode;
   bool LastErrorPassesLineFilter;
+  // Set when the last diagnostic was dropped by isInCheckedHeader(), so that
+  // its notes are dropped as well.
+  bool LastErrorSkipped;
 };
 
 } // end namespace tidy
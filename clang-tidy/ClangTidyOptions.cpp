@@ -86,6 +86,7 @@ template <> struct MappingTraits<ClangTidyOptions> {
     IO.mapOptional("Checks", Options.Checks);
     IO.mapOptional("HeaderFilterRegex", Options.HeaderFilterRegex);
     IO.mapOptional("AnalyzeTemporaryDtors", Options.AnalyzeTemporaryDtors);
+    IO.mapOptional("AnalyzerMaxNodes", Options.AnalyzerMaxNodes);
     IO.mapOptional("User", Options.User);
     IO.mapOptional("CheckOptions", NOpts->Options);
   }
@@ -97,7 +98,7 @@ template <> struct MappingTraits<ClangTidyOptions> {
 namespace clang {
 namespace tidy {
 
-ClangTidyOptions ClangTidyOptions::getDefaults() {
+static ClangTidyOptions computeDefaults() {
   ClangTidyOptions Options;
   Options.Checks = "";
   Options.HeaderFilterRegex = "";
@@ -111,6 +112,12 @@ ClangTidyOptions ClangTidyOptions::getDefaults() {
   return Options;
 }
 
+const ClangTidyOptions &ClangTidyOptions::getDefaults() {
+  // Instantiating the modules is expensive, and the registry doesn't change.
+  static const ClangTidyOptions Defaults = computeDefaults();
+  return Defaults;
+}
+
 ClangTidyOptions
 ClangTidyOptions::mergeWith(const ClangTidyOptions &Other) const {
   ClangTidyOptions Result = *this;
@@ -127,6 +134,8 @@ ClangTidyOptions::mergeWith(const ClangTidyOptions &Other) const {
     Result.SystemHeaders = Other.SystemHeaders;
   if (Other.AnalyzeTemporaryDtors)
     Result.AnalyzeTemporaryDtors = Other.AnalyzeTemporaryDtors;
+  if (Other.AnalyzerMaxNodes)
+    Result.AnalyzerMaxNodes = Other.AnalyzerMaxNodes;
   if (Other.User)
     Result.User = Other.User;
 
@@ -143,7 +152,9 @@ FileOptionsProvider::FileOptionsProvider(
     : DefaultOptionsProvider(GlobalOptions, DefaultOptions),
       OverrideOptions(OverrideOptions) {
   ConfigHandlers.emplace_back(".clang-tidy", parseConfiguration);
-  CachedOptions[""] = DefaultOptions.mergeWith(OverrideOptions);
+  OptionsStorage.emplace_back(
+      new ClangTidyOptions(DefaultOptions.mergeWith(OverrideOptions)));
+  CachedOptions[""] = {OptionsStorage.front().get(), nullptr};
 }
 
 FileOptionsProvider::FileOptionsProvider(
@@ -153,7 +164,9 @@ FileOptionsProvider::FileOptionsProvider(
     const FileOptionsProvider::ConfigFileHandlers &ConfigHandlers)
     : DefaultOptionsProvider(GlobalOptions, DefaultOptions),
       OverrideOptions(OverrideOptions), ConfigHandlers(ConfigHandlers) {
-  CachedOptions[""] = DefaultOptions.mergeWith(OverrideOptions);
+  OptionsStorage.emplace_back(
+      new ClangTidyOptions(DefaultOptions.mergeWith(OverrideOptions)));
+  CachedOptions[""] = {OptionsStorage.front().get(), nullptr};
 }
 
 // FIXME: This method has some common logic with clang::format::getStyle().
@@ -172,53 +185,106 @@ const ClangTidyOptions &FileOptionsProvider::getOptions(StringRef FileName) {
   }
 
   // Look for a suitable configuration file in all parent directories of the
-  // file. Start with the immediate parent directory and move up.
-  StringRef Path = llvm::sys::path::parent_path(FileName);
-  for (StringRef CurrentPath = Path;;
-       CurrentPath = llvm::sys::path::parent_path(CurrentPath)) {
-    llvm::Optional<ClangTidyOptions> Result;
-
+  // file. Start with the immediate parent directory and move up. The root
+  // directory "" is always cached.
+  StringRef CurrentPath = llvm::sys::path::parent_path(FileName);
+  // The directories looked at, each with the number of configuration files
+  // found before it.
+  SmallVector<std::pair<StringRef, size_t>, 8> Directories;
+  size_t FirstNewFile = ConfigFiles.size();
+  CachedDirectory Result = {nullptr, nullptr};
+  for (;; CurrentPath = llvm::sys::path::parent_path(CurrentPath)) {
     auto Iter = CachedOptions.find(CurrentPath);
-    if (Iter != CachedOptions.end())
+    if (Iter != CachedOptions.end()) {
       Result = Iter->second;
+      break;
+    }
+    Directories.push_back(std::make_pair(CurrentPath, ConfigFiles.size()));
+    if (llvm::Optional<ClangTidyOptions> Options =
+            TryReadConfigFile(CurrentPath)) {
+      OptionsStorage.emplace_back(new ClangTidyOptions(std::move(*Options)));
+      Result.Options = OptionsStorage.back().get();
+      break;
+    }
+  }
+
+  // Chain the configuration files found by this lookup in front of the ones
+  // the options already depended on.
+  const ConfigFileStatus *Inherited = Result.ConfigFiles;
+  for (size_t I = ConfigFiles.size(); I != FirstNewFile; --I) {
+    ConfigFiles[I - 1]->Next = Result.ConfigFiles;
+    Result.ConfigFiles = ConfigFiles[I - 1].get();
+  }
+
+  // Store cached value for all directories looked at, so that they aren't
+  // searched for configuration files again.
+  for (const auto &Directory : Directories) {
+    DEBUG(llvm::dbgs() << "Caching configuration for path " << Directory.first
+                       << ".\n");
+    CachedDirectory &Cached = CachedOptions[Directory.first];
+    Cached.Options = Result.Options;
+    Cached.ConfigFiles = Directory.second < ConfigFiles.size()
+                             ? ConfigFiles[Directory.second].get()
+                             : Inherited;
+  }
+  return *Result.Options;
+}
+
+bool FileOptionsProvider::invalidateChangedConfigFiles(StringRef FileName) {
+  SmallString<256> FilePath(FileName);
+  // getOptions() reports the error.
+  if (!llvm::sys::fs::make_absolute(FilePath))
+    FileName = FilePath;
 
-    if (!Result)
-      Result = TryReadConfigFile(CurrentPath);
-
-    if (Result) {
-      // Store cached value for all intermediate directories.
-      while (Path != CurrentPath) {
-        DEBUG(llvm::dbgs() << "Caching configuration for path " << Path
-                           << ".\n");
-        CachedOptions.GetOrCreateValue(Path, *Result);
-        Path = llvm::sys::path::parent_path(Path);
-      }
-      return CachedOptions.GetOrCreateValue(Path, *Result).getValue();
+  // Only the files of the closest directory looked at before matter, that's
+  // where getOptions() will stop.
+  StringRef Path = llvm::sys::path::parent_path(FileName);
+  auto Iter = CachedOptions.find(Path);
+  while (Iter == CachedOptions.end()) {
+    Path = llvm::sys::path::parent_path(Path);
+    Iter = CachedOptions.find(Path);
+  }
+
+  bool Changed = false;
+  for (const ConfigFileStatus *File = Iter->second.ConfigFiles; File;
+       File = File->Next) {
+    llvm::sys::fs::file_status Status;
+    if (llvm::sys::fs::status(File->Path, Status) ||
+        !llvm::sys::fs::is_regular_file(Status) ||
+        Status.getLastModificationTime() != File->ModificationTime ||
+        Status.getSize() != File->Size) {
+      Changed = true;
+      break;
     }
   }
+  if (!Changed)
+    return false;
+
+  // Keep OptionsStorage, callers may still refer to the old options.
+  CachedOptions.clear();
+  CachedOptions[""] = {OptionsStorage.front().get(), nullptr};
+  ConfigFiles.clear();
+  return true;
 }
 
 llvm::Optional<ClangTidyOptions>
 FileOptionsProvider::TryReadConfigFile(StringRef Directory) {
   assert(!Directory.empty());
 
-  if (!llvm::sys::fs::is_directory(Directory)) {
-    llvm::errs() << "Error reading configuration from " << Directory
-                 << ": directory doesn't exist.\n";
-    return llvm::None;
-  }
-
   for (const ConfigFileHandler &ConfigHandler : ConfigHandlers) {
     SmallString<128> ConfigFile(Directory);
     llvm::sys::path::append(ConfigFile, ConfigHandler.first);
     DEBUG(llvm::dbgs() << "Trying " << ConfigFile << "...\n");
 
-    bool IsFile = false;
-    // Ignore errors from is_regular_file: we only need to know if we can read
-    // the file or not.
-    llvm::sys::fs::is_regular_file(Twine(ConfigFile), IsFile);
-    if (!IsFile)
+    // Ignore errors from status: we only need to know if we can read the file
+    // or not. This also covers directories that don't exist.
+    llvm::sys::fs::file_status Status;
+    if (llvm::sys::fs::status(Twine(ConfigFile), Status) ||
+        !llvm::sys::fs::is_regular_file(Status))
       continue;
+    ConfigFiles.emplace_back(new ConfigFileStatus{
+        ConfigFile.str(), Status.getLastModificationTime(), Status.getSize(),
+        nullptr});
 
     llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Text =
         llvm::MemoryBuffer::getFile(ConfigFile.c_str());
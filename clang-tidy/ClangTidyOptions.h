@@ -14,8 +14,10 @@
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/TimeValue.h"
 #include <functional>
 #include <map>
+#include <memory>
 #include <string>
 #include <system_error>
 #include <utility>
@@ -36,12 +38,41 @@ struct FileFilter {
   std::vector<LineRange> LineRanges;
 };
 
+/// \brief How much work a check does per translation unit, from the cheapest
+/// to the most expensive class.
+enum CheckCostClass {
+  /// \brief Only looks at tokens or preprocessor callbacks.
+  CCC_Lexical,
+  /// \brief Looks at each matched AST node and its close neighbours.
+  CCC_ASTLocal,
+  /// \brief Collects information over the whole translation unit.
+  CCC_WholeTranslationUnit,
+  /// \brief Explores the paths through functions, like the static analyzer.
+  CCC_PathSensitive
+};
+
 /// \brief Global options. These options are neither stored nor read from
 /// configuration files.
 struct ClangTidyGlobalOptions {
+  ClangTidyGlobalOptions()
+      : SkipCheckedHeaders(false), SkipFilteredCode(false),
+        MaxCheckCost(CCC_PathSensitive) {}
+
   /// \brief Output warnings from certain line ranges of certain files only.
   /// If empty, no warnings will be filtered.
   std::vector<FileFilter> LineFilter;
+
+  /// \brief Don't report diagnostics again in headers that were already checked
+  /// by an earlier translation unit with the same options.
+  bool SkipCheckedHeaders;
+
+  /// \brief Don't run location-local checks on AST nodes in files whose
+  /// warnings are never reported, e.g. system headers or headers not matching
+  /// the header filter. See \c ClangTidyCheck::isLocationLocal().
+  bool SkipFilteredCode;
+
+  /// \brief Only run the enabled checks whose cost class is at most this one.
+  CheckCostClass MaxCheckCost;
 };
 
 /// \brief Contains options for clang-tidy. These options may be read from
@@ -52,8 +83,8 @@ struct ClangTidyOptions {
   ///
   /// Allow no checks and no headers by default. This method initializes
   /// check-specific options by calling \c ClangTidyModule::getModuleOptions()
-  /// of each registered \c ClangTidyModule.
-  static ClangTidyOptions getDefaults();
+  /// of each registered \c ClangTidyModule. They are computed once.
+  static const ClangTidyOptions &getDefaults();
 
   /// \brief Creates a new \c ClangTidyOptions instance combined from all fields
   /// of this instance overridden by the fields of \p Other that have a value.
@@ -72,6 +103,11 @@ struct ClangTidyOptions {
   /// \brief Turns on temporary destructor-based analysis.
   llvm::Optional<bool> AnalyzeTemporaryDtors;
 
+  /// \brief Maximum number of nodes the static analyzer creates for each
+  /// top-level function. The paths not explored yet when it is reached are
+  /// dropped. If not set, the analyzer's default is used.
+  llvm::Optional<unsigned> AnalyzerMaxNodes;
+
   /// \brief Specifies the name or e-mail of the user running clang-tidy.
   ///
   /// This option is used, for example, to place the correct user name in TODO()
@@ -95,7 +131,20 @@ public:
 
   /// \brief Returns options applying to a specific translation unit with the
   /// specified \p FileName.
+  ///
+  /// The returned options must not change while the provider exists, as
+  /// \c ClangTidyContext caches what it derives from them by their address.
   virtual const ClangTidyOptions &getOptions(llvm::StringRef FileName) = 0;
+
+  /// \brief Forgets the cached options if a configuration file the options of
+  /// \p FileName were read from was modified or removed since, and returns
+  /// \c true if it did.
+  ///
+  /// Called before the options of each translation unit are looked up.
+  /// References returned by \c getOptions() before must stay valid.
+  virtual bool invalidateChangedConfigFiles(llvm::StringRef FileName) {
+    return false;
+  }
 };
 
 /// \brief Implementation of the \c ClangTidyOptionsProvider interface, which
@@ -121,6 +170,10 @@ private:
 /// tries to find a configuration file in the closest parent directory of each
 /// source file.
 ///
+/// The options of each directory are cached, including directories without a
+/// configuration file, so files in a directory seen before only cost a lookup.
+/// Parallel runs serialize access to the provider, it doesn't lock itself.
+///
 /// By default, files named ".clang-tidy" will be considered, and the
 /// \c clang::tidy::parseConfiguration function will be used for parsing, but a
 /// custom set of configuration file names and parsing functions can be
@@ -189,12 +242,49 @@ public:
 
   const ClangTidyOptions &getOptions(llvm::StringRef FileName) override;
 
+  /// \brief Forgets all cached options if one of the configuration files
+  /// found while looking up the options of \p FileName was modified or
+  /// removed since. Only these files are checked.
+  ///
+  /// A file counts as modified if its modification time or size changed, so
+  /// an edit that keeps the size within the granularity of the file system
+  /// timestamps isn't noticed. Configuration files created since aren't
+  /// noticed either.
+  bool invalidateChangedConfigFiles(llvm::StringRef FileName) override;
+
 private:
+  /// \brief A configuration file found by \c TryReadConfigFile.
+  struct ConfigFileStatus {
+    std::string Path;
+    llvm::sys::TimeValue ModificationTime;
+    uint64_t Size;
+    /// \brief The next configuration file found further up the directory
+    /// tree by the same lookup, or null.
+    const ConfigFileStatus *Next;
+  };
+
+  /// \brief The options of a directory and the configuration files they
+  /// depend on.
+  struct CachedDirectory {
+    const ClangTidyOptions *Options;
+    /// \brief The first configuration file found in or above the directory,
+    /// the others are linked from it. Null if there are none.
+    const ConfigFileStatus *ConfigFiles;
+  };
+
   /// \brief Try to read configuration files from \p Directory using registered
   /// \c ConfigHandlers.
   llvm::Optional<ClangTidyOptions> TryReadConfigFile(llvm::StringRef Directory);
 
-  llvm::StringMap<ClangTidyOptions> CachedOptions;
+  /// \brief Options of each directory looked at. Directories without a
+  /// configuration file share the options of their parent.
+  llvm::StringMap<CachedDirectory> CachedOptions;
+  /// \brief The distinct options in \c CachedOptions, starting with the ones
+  /// used when no configuration file is found.
+  std::vector<std::unique_ptr<ClangTidyOptions>> OptionsStorage;
+  /// \brief The configuration files referred to by \c CachedOptions, in the
+  /// order they were found.
+  std::vector<std::unique_ptr<ConfigFileStatus>> ConfigFiles;
   ClangTidyOptions OverrideOptions;
   ConfigFileHandlers ConfigHandlers;
 };
@@ -0,0 +1,296 @@
+//===--- ClangTidyPreambleStore.cpp - clang-tidy ----------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+///  \file This file implements the precompiled preambles shared by the
+///  translation units of a clang-tidy run.
+///
+//===----------------------------------------------------------------------===//
+
+#include "ClangTidyPreambleStore.h"
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/FileManager.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "clang/Frontend/FrontendActions.h"
+#include "clang/Lex/Lexer.h"
+#include "clang/Lex/PreprocessorOptions.h"
+#include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace clang {
+namespace tidy {
+
+namespace {
+
+/// \brief Returns the size of the leading block of \c #include and \c #import
+/// directives of \p Contents, which always ends at the start of a line.
+unsigned computePreambleSize(StringRef Contents) {
+  // Raw lexing with a fake file location at offset 1 gives the offsets of the
+  // tokens, as in Lexer::ComputePreamble.
+  const unsigned StartOffset = 1;
+  LangOptions LangOpts;
+  Lexer RawLexer(SourceLocation::getFromRawEncoding(StartOffset), LangOpts,
+                 Contents.begin(), Contents.begin(), Contents.end());
+  auto getOffset = [&](const Token &Tok) {
+    return Tok.getLocation().getRawEncoding() - StartOffset;
+  };
+
+  unsigned Size = 0;
+  Token Tok;
+  RawLexer.LexFromRawLexer(Tok);
+  while (Tok.is(tok::hash) && Tok.isAtStartOfLine()) {
+    RawLexer.LexFromRawLexer(Tok);
+    if (Tok.isNot(tok::raw_identifier) ||
+        (Tok.getRawIdentifier() != "include" &&
+         Tok.getRawIdentifier() != "import"))
+      break;
+
+    unsigned DirectiveEnd = getOffset(Tok) + Tok.getLength();
+    RawLexer.LexFromRawLexer(Tok);
+    while (Tok.isNot(tok::eof) && !Tok.isAtStartOfLine()) {
+      DirectiveEnd = getOffset(Tok) + Tok.getLength();
+      RawLexer.LexFromRawLexer(Tok);
+    }
+
+    // Only cut the main file after the end of the line if nothing but a line
+    // comment follows the directive.
+    size_t LineEnd = Contents.find('\n', DirectiveEnd);
+    if (LineEnd == StringRef::npos)
+      break;
+    StringRef Rest = Contents.slice(DirectiveEnd, LineEnd).trim();
+    if (!Rest.empty() && (!Rest.startswith("//") || Rest.endswith("\\")))
+      break;
+    Size = LineEnd + 1;
+  }
+  return Size;
+}
+
+/// \brief Returns \c true if \p Arg names \p MainFile, either directly or
+/// relative to \p Directory.
+bool isMainFileArgument(StringRef Arg, StringRef MainFile,
+                        StringRef Directory) {
+  if (Arg == MainFile)
+    return true;
+  if (llvm::sys::path::is_absolute(Arg))
+    return false;
+  SmallString<128> Path(Directory);
+  llvm::sys::path::append(Path, Arg);
+  return Path.str() == MainFile;
+}
+
+void hashString(llvm::MD5 &Hash, StringRef S) {
+  uint64_t Size = S.size();
+  Hash.update(ArrayRef<uint8_t>(reinterpret_cast<const uint8_t *>(&Size),
+                                sizeof(Size)));
+  Hash.update(S);
+}
+
+/// \brief Builds the PCH of a preamble from the compile command of one of the
+/// translation units sharing it.
+class PreambleBuilder : public tooling::ToolAction {
+public:
+  PreambleBuilder(StringRef HeaderPath, StringRef HeaderContents,
+                  StringRef PCHPath, std::vector<std::string> &Files)
+      : HeaderPath(HeaderPath), HeaderContents(HeaderContents),
+        PCHPath(PCHPath), Files(Files) {}
+
+  bool runInvocation(CompilerInvocation *Invocation, FileManager *FileMgr,
+                     DiagnosticConsumer *DiagConsumer) override {
+    // Files included implicitly would be included again by the translation
+    // units using the PCH.
+    const PreprocessorOptions &PPOpts = Invocation->getPreprocessorOpts();
+    if (!PPOpts.Includes.empty() || !PPOpts.MacroIncludes.empty() ||
+        !PPOpts.ImplicitPCHInclude.empty() ||
+        !PPOpts.ImplicitPTHInclude.empty())
+      return false;
+
+    FrontendOptions &FrontendOpts = Invocation->getFrontendOpts();
+    if (FrontendOpts.Inputs.size() != 1)
+      return false;
+    InputKind Kind = FrontendOpts.Inputs[0].getKind();
+    FrontendOpts.Inputs.clear();
+    FrontendOpts.Inputs.push_back(FrontendInputFile(HeaderPath, Kind));
+    FrontendOpts.OutputFile = PCHPath;
+    FrontendOpts.ProgramAction = frontend::GeneratePCH;
+    // The header is a virtual file next to the main file, so that its quoted
+    // includes are looked up as in the main file.
+    Invocation->getPreprocessorOpts().addRemappedFile(
+        HeaderPath,
+        llvm::MemoryBuffer::getMemBufferCopy(HeaderContents).release());
+
+    CompilerInstance Compiler;
+    Compiler.setInvocation(Invocation);
+    Compiler.setFileManager(FileMgr);
+    Compiler.createDiagnostics(DiagConsumer, /*ShouldOwnClient=*/false);
+    if (!Compiler.hasDiagnostics())
+      return false;
+    Compiler.createSourceManager(*FileMgr);
+
+    Action BuildAction(HeaderPath, Files);
+    bool Success = Compiler.ExecuteAction(BuildAction);
+    FileMgr->clearStatCaches();
+    return Success;
+  }
+
+private:
+  class Action : public GeneratePCHAction {
+  public:
+    Action(StringRef HeaderPath, std::vector<std::string> &Files)
+        : HeaderPath(HeaderPath), Files(Files) {}
+
+    void EndSourceFileAction() override {
+      SourceManager &SM = getCompilerInstance().getSourceManager();
+      FileManager &FileMgr = getCompilerInstance().getFileManager();
+      for (auto I = SM.fileinfo_begin(), E = SM.fileinfo_end(); I != E; ++I) {
+        SmallString<128> Path(I->first->getName());
+        FileMgr.FixupRelativePath(Path);
+        llvm::sys::fs::make_absolute(Path);
+        if (Path.str() != HeaderPath)
+          Files.push_back(Path.str());
+      }
+    }
+
+  private:
+    StringRef HeaderPath;
+    std::vector<std::string> &Files;
+  };
+
+  StringRef HeaderPath;
+  StringRef HeaderContents;
+  StringRef PCHPath;
+  std::vector<std::string> &Files;
+};
+
+} // end anonymous namespace
+
+ClangTidyPreambleStore::ClangTidyPreambleStore() : NumBuilt(0), NumReused(0) {}
+
+ClangTidyPreambleStore::~ClangTidyPreambleStore() {
+  for (const auto &E : Entries) {
+    if (!E.getValue()->PCHPath.empty())
+      llvm::sys::fs::remove(E.getValue()->PCHPath);
+  }
+}
+
+ClangTidyPreambleStore::Preamble
+ClangTidyPreambleStore::getPreamble(StringRef MainFile, StringRef Directory,
+                                    ArrayRef<std::string> CommandLine,
+                                    StringRef OptionsKey) {
+  Preamble Result;
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Buffer =
+      llvm::MemoryBuffer::getFile(MainFile);
+  if (!Buffer)
+    return Result;
+  StringRef Contents = (*Buffer)->getBuffer();
+  StringRef PreambleText = Contents.substr(0, computePreambleSize(Contents));
+  if (PreambleText.empty())
+    return Result;
+
+  llvm::MD5 Hash;
+  for (const std::string &Arg : CommandLine)
+    if (!isMainFileArgument(Arg, MainFile, Directory))
+      hashString(Hash, Arg);
+  hashString(Hash, Directory);
+  hashString(Hash, llvm::sys::path::parent_path(MainFile));
+  hashString(Hash, OptionsKey);
+  hashString(Hash, PreambleText);
+  llvm::MD5::MD5Result Digest;
+  Hash.final(Digest);
+  SmallString<32> Key;
+  llvm::MD5::stringifyResult(Digest, Key);
+  Result.Key = Key.str();
+
+  Entry *E;
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    std::unique_ptr<Entry> &Slot = Entries[Result.Key];
+    if (!Slot) {
+      Slot.reset(new Entry);
+      Result.Usage = PU_Probe;
+      return Result;
+    }
+    E = Slot.get();
+  }
+
+  std::lock_guard<std::mutex> Lock(E->Mutex);
+  if (E->State == ES_Usable)
+    E->State =
+        build(*E, MainFile, Directory, CommandLine, PreambleText, Result.Key)
+            ? ES_Built
+            : ES_Unusable;
+  if (E->State != ES_Built)
+    return Result;
+
+  Result.Usage = PU_Use;
+  Result.PCHPath = E->PCHPath;
+  Result.HeaderPath = E->HeaderPath;
+  Result.HeaderContents = E->HeaderContents;
+  Result.Files = &E->Files;
+  Result.MainFileContents = Contents;
+  for (size_t I = 0, End = PreambleText.size(); I != End; ++I) {
+    char &C = Result.MainFileContents[I];
+    if (C != '\n' && C != '\r')
+      C = ' ';
+  }
+  return Result;
+}
+
+void ClangTidyPreambleStore::setProbeResult(StringRef Key, bool Usable) {
+  Entry *E;
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    auto I = Entries.find(Key);
+    assert(I != Entries.end() && "No translation unit probed this preamble");
+    E = I->getValue().get();
+  }
+  std::lock_guard<std::mutex> Lock(E->Mutex);
+  assert(E->State == ES_Probing);
+  E->State = Usable ? ES_Usable : ES_Unusable;
+}
+
+bool ClangTidyPreambleStore::build(Entry &E, StringRef MainFile,
+                                   StringRef Directory,
+                                   ArrayRef<std::string> CommandLine,
+                                   StringRef PreambleText, StringRef Key) {
+  // The header is never written to disk. Naming it after the group keeps the
+  // headers of different groups in the same directory apart.
+  SmallString<128> HeaderPath(llvm::sys::path::parent_path(MainFile));
+  llvm::sys::path::append(HeaderPath, "clang-tidy-preamble-" + Key + ".h");
+  E.HeaderPath = HeaderPath.str();
+  E.HeaderContents = PreambleText;
+
+  SmallString<128> PCHPath;
+  if (llvm::sys::fs::createTemporaryFile("clang-tidy-preamble", "pch",
+                                         PCHPath))
+    return false;
+  E.PCHPath = PCHPath.str();
+
+  PreambleBuilder Builder(E.HeaderPath, E.HeaderContents, E.PCHPath, E.Files);
+  FileSystemOptions FileSystemOpts;
+  FileSystemOpts.WorkingDir = Directory;
+  IntrusiveRefCntPtr<FileManager> Files(new FileManager(FileSystemOpts));
+  // The base class only counts the diagnostics.
+  DiagnosticConsumer Diags;
+  tooling::ToolInvocation Invocation(CommandLine.vec(), &Builder,
+                                     Files.get());
+  Invocation.setDiagnosticConsumer(&Diags);
+  if (!Invocation.run() || Diags.getNumWarnings() || Diags.getNumErrors())
+    return false;
+  ++NumBuilt;
+  return true;
+}
+
+} // end namespace tidy
+} // end namespace clang
@@ -0,0 +1,127 @@
+//===--- ClangTidyPreambleStore.h - clang-tidy ------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_CLANG_TIDY_PREAMBLE_STORE_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_CLANG_TIDY_PREAMBLE_STORE_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace tidy {
+
+/// \brief Precompiled preambles shared by the translation units of a
+/// clang-tidy run.
+///
+/// The preamble of a main file is its leading block of \c #include and
+/// \c #import directives. Translation units with the same preamble, compile
+/// command, directory and options share a single PCH built from it. The
+/// preamble is then blanked out of the main file, so that offsets in it don't
+/// change, and the PCH is included instead.
+///
+/// The first translation unit of each group is processed without a PCH. It
+/// tells whether the checks depend on preprocessor callbacks, which don't see
+/// the directives in a PCH; the PCH is only built if they don't. A PCH whose
+/// preamble produces any diagnostic is not used either.
+///
+/// The preamble is built as a virtual header in the directory of the main
+/// file, which has to be remapped to its contents wherever the PCH is used.
+///
+/// The store is safe to use from several threads. PCHs are removed when the
+/// store is destroyed.
+class ClangTidyPreambleStore {
+public:
+  enum PreambleUsage {
+    /// \brief Process the translation unit without a preamble.
+    PU_None,
+    /// \brief Process the translation unit without a preamble, and report
+    /// whether a preamble can be used for its group with \c setProbeResult().
+    PU_Probe,
+    /// \brief Process the translation unit with the PCH of the preamble.
+    PU_Use
+  };
+
+  struct Preamble {
+    Preamble() : Usage(PU_None), Files(nullptr) {}
+
+    PreambleUsage Usage;
+    /// \brief Identifies the group of the translation unit.
+    std::string Key;
+    std::string PCHPath;
+    /// \brief The header the PCH was built from, a virtual file in the
+    /// directory of the main file.
+    std::string HeaderPath;
+    /// \brief The contents \c HeaderPath has to be remapped to.
+    std::string HeaderContents;
+    /// \brief The contents of the main file with the preamble replaced by
+    /// whitespace.
+    std::string MainFileContents;
+    /// \brief Absolute paths of the files read while building the PCH, except
+    /// \c HeaderPath.
+    const std::vector<std::string> *Files;
+  };
+
+  ClangTidyPreambleStore();
+  ~ClangTidyPreambleStore();
+
+  /// \brief Decides how to process \p MainFile with the tool command line
+  /// \p CommandLine in \p Directory and options described by \p OptionsKey,
+  /// building the PCH if it is needed and doesn't exist yet.
+  Preamble getPreamble(StringRef MainFile, StringRef Directory,
+                       ArrayRef<std::string> CommandLine, StringRef OptionsKey);
+
+  /// \brief Records whether a preamble can be used for the group \p Key after
+  /// processing a translation unit for which \c getPreamble() returned
+  /// \c PU_Probe.
+  void setProbeResult(StringRef Key, bool Usable);
+
+  /// \brief Returns the number of PCHs built so far.
+  unsigned getNumBuilt() const { return NumBuilt; }
+
+  /// \brief Records that a translation unit was processed successfully with
+  /// the PCH returned by \c getPreamble().
+  void addReused() { ++NumReused; }
+
+  /// \brief Returns the number of translation units processed with a PCH.
+  unsigned getNumReused() const { return NumReused; }
+
+private:
+  enum EntryState { ES_Probing, ES_Usable, ES_Built, ES_Unusable };
+
+  struct Entry {
+    Entry() : State(ES_Probing) {}
+
+    std::mutex Mutex;
+    EntryState State;
+    std::string HeaderPath;
+    std::string HeaderContents;
+    std::string PCHPath;
+    std::vector<std::string> Files;
+  };
+
+  bool build(Entry &E, StringRef MainFile, StringRef Directory,
+             ArrayRef<std::string> CommandLine, StringRef PreambleText,
+             StringRef Key);
+
+  std::mutex Mutex;
+  llvm::StringMap<std::unique_ptr<Entry>> Entries;
+  std::atomic<unsigned> NumBuilt;
+  std::atomic<unsigned> NumReused;
+};
+
+} // end namespace tidy
+} // end namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_CLANG_TIDY_PREAMBLE_STORE_H
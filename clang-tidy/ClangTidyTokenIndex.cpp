@@ -0,0 +1,65 @@
+//===--- ClangTidyTokenIndex.cpp - clang-tidy -------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+///  \file This file implements the raw token index shared by the checks
+///  looking at the tokens of a file.
+///
+//===----------------------------------------------------------------------===//
+
+#include "ClangTidyTokenIndex.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Lex/Lexer.h"
+#include <algorithm>
+
+namespace clang {
+namespace tidy {
+
+TokenIndex::TokenIndex(const SourceManager &SM, FileID FID,
+                       const LangOptions &LangOpts)
+    : FileSize(0) {
+  bool Invalid = false;
+  const SrcMgr::SLocEntry &Entry = SM.getSLocEntry(FID, &Invalid);
+  if (Invalid || !Entry.isFile())
+    return;
+  StringRef Buffer = SM.getBufferData(FID, &Invalid);
+  if (Invalid)
+    return;
+  FileStart = SM.getLocForStartOfFile(FID);
+  FileSize = Buffer.size();
+
+  Lexer RawLexer(FileStart, LangOpts, Buffer.begin(), Buffer.begin(),
+                 Buffer.end());
+  RawLexer.SetCommentRetentionState(true);
+  Token Tok;
+  do {
+    RawLexer.LexFromRawLexer(Tok);
+    Tokens.push_back(Tok);
+  } while (Tok.isNot(tok::eof));
+}
+
+bool TokenIndex::contains(SourceLocation Loc) const {
+  if (Tokens.empty() || !Loc.isFileID())
+    return false;
+  unsigned Raw = Loc.getRawEncoding();
+  unsigned Start = FileStart.getRawEncoding();
+  return Raw >= Start && Raw - Start <= FileSize;
+}
+
+size_t TokenIndex::find(SourceLocation Loc) const {
+  unsigned Offset = getOffset(Loc);
+  // The end offsets of the tokens are sorted.
+  auto I = std::partition_point(
+      Tokens.begin(), Tokens.end() - 1, [&](const Token &Tok) {
+        return getOffset(Tok.getLocation()) + Tok.getLength() <= Offset;
+      });
+  return I - Tokens.begin();
+}
+
+} // end namespace tidy
+} // end namespace clang
@@ -0,0 +1,74 @@
+//===--- ClangTidyTokenIndex.h - clang-tidy ---------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_CLANG_TIDY_TOKEN_INDEX_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_CLANG_TIDY_TOKEN_INDEX_H
+
+#include "clang/Basic/LLVM.h"
+#include "clang/Basic/SourceLocation.h"
+#include "clang/Lex/Token.h"
+#include "llvm/ADT/ArrayRef.h"
+#include <vector>
+
+namespace clang {
+
+class LangOptions;
+class SourceManager;
+
+namespace tidy {
+
+/// \brief The raw tokens and comments of a file, lexed once from the start of
+/// the file.
+///
+/// Checks get the index of a file from \c ClangTidyCheck::getTokenIndex()
+/// instead of running a raw \c Lexer at each match. The tokens are in source
+/// order and the last one is \c tok::eof at the end of the file. Identifiers
+/// are \c tok::raw_identifier, as with \c Lexer::LexFromRawLexer().
+///
+/// The index is empty if the \c FileID is a macro expansion or the file isn't
+/// backed by a buffer. Only file locations for which \c contains() returns
+/// \c true can be looked up.
+class TokenIndex {
+public:
+  TokenIndex(const SourceManager &SM, FileID FID, const LangOptions &LangOpts);
+
+  /// \brief Returns all tokens of the file, followed by \c tok::eof.
+  ArrayRef<Token> tokens() const { return Tokens; }
+
+  /// \brief Returns \c true if \p Loc is a file location inside the indexed
+  /// file, including its end.
+  bool contains(SourceLocation Loc) const;
+
+  /// \brief Returns the offset of \p Loc in the file.
+  unsigned getOffset(SourceLocation Loc) const {
+    assert(contains(Loc));
+    return Loc.getRawEncoding() - FileStart.getRawEncoding();
+  }
+
+  /// \brief Returns the index in \c tokens() of the token containing \p Loc,
+  /// or of the first token after it if \p Loc is in whitespace.
+  ///
+  /// Returns the index of the \c tok::eof token if there is none.
+  size_t find(SourceLocation Loc) const;
+
+  /// \brief Returns the token containing \p Loc, or the first token after it.
+  const Token &getTokenAt(SourceLocation Loc) const {
+    return Tokens[find(Loc)];
+  }
+
+private:
+  std::vector<Token> Tokens;
+  SourceLocation FileStart;
+  unsigned FileSize;
+};
+
+} // end namespace tidy
+} // end namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_CLANG_TIDY_TOKEN_INDEX_H
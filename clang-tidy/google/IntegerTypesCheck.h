@@ -26,6 +26,7 @@ public:
         SignedTypePrefix("int"), AddUnderscoreT(false) {}
   void registerMatchers(ast_matchers::MatchFinder *Finder) override;
   void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
+  bool isReusable() const override { return true; }
 
 private:
   const StringRef UnsignedTypePrefix;
@@ -23,6 +23,7 @@ class TodoCommentCheck : public ClangTidyCheck {
 public:
   TodoCommentCheck(StringRef Name, ClangTidyContext *Context);
   void registerPPCallbacks(CompilerInstance &Compiler) override;
+  CheckCostClass getCostClass() const override { return CCC_Lexical; }
 
 private:
   class TodoCommentHandler;
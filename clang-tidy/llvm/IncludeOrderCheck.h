@@ -23,6 +23,7 @@ public:
   IncludeOrderCheck(StringRef Name, ClangTidyContext *Context)
       : ClangTidyCheck(Name, Context) {}
   void registerPPCallbacks(CompilerInstance &Compiler) override;
+  CheckCostClass getCostClass() const override { return CCC_Lexical; }
 };
 
 } // namespace tidy
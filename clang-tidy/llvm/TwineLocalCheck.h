@@ -23,6 +23,13 @@ public:
       : ClangTidyCheck(Name, Context) {}
   void registerMatchers(ast_matchers::MatchFinder *Finder) override;
   void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
+  bool isReusable() const override { return true; }
+  bool isLanguageSupported(const LangOptions &LangOpts) const override {
+    return LangOpts.CPlusPlus;
+  }
+  std::vector<StringRef> getRequiredIdentifiers() const override {
+    return std::vector<StringRef>(1, "Twine");
+  }
 };
 
 } // namespace tidy
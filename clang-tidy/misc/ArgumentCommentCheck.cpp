@@ -10,7 +10,6 @@
 #include "ArgumentCommentCheck.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
-#include "clang/Lex/Lexer.h"
 #include "clang/Lex/Token.h"
 
 using namespace clang::ast_matchers;
@@ -40,38 +39,20 @@ std::vector<std::pair<SourceLocation, StringRef>>
 ArgumentCommentCheck::getCommentsInRange(ASTContext *Ctx, SourceRange Range) {
   std::vector<std::pair<SourceLocation, StringRef>> Comments;
   auto &SM = Ctx->getSourceManager();
-  std::pair<FileID, unsigned> BeginLoc = SM.getDecomposedLoc(Range.getBegin()),
-                              EndLoc = SM.getDecomposedLoc(Range.getEnd());
-
-  if (BeginLoc.first != EndLoc.first)
-    return Comments;
-
-  bool Invalid = false;
-  StringRef Buffer = SM.getBufferData(BeginLoc.first, &Invalid);
-  if (Invalid)
+  const TokenIndex &Index = getTokenIndex(
+      SM, SM.getFileID(Range.getBegin()), Ctx->getLangOpts());
+  if (!Index.contains(Range.getBegin()) || !Index.contains(Range.getEnd()))
     return Comments;
 
-  const char *StrData = Buffer.data() + BeginLoc.second;
-
-  Lexer TheLexer(SM.getLocForStartOfFile(BeginLoc.first), Ctx->getLangOpts(),
-                 Buffer.begin(), StrData, Buffer.end());
-  TheLexer.SetCommentRetentionState(true);
-
-  for (;;) {
-    Token Tok;
-    if (TheLexer.LexFromRawLexer(Tok))
-      break;
-    if (Tok.getLocation() == Range.getEnd() || Tok.getKind() == tok::eof)
+  unsigned EndOffset = Index.getOffset(Range.getEnd());
+  for (const Token &Tok : Index.tokens().slice(Index.find(Range.getBegin()))) {
+    if (Tok.is(tok::eof) || Index.getOffset(Tok.getLocation()) >= EndOffset)
       break;
 
-    if (Tok.getKind() == tok::comment) {
-      std::pair<FileID, unsigned> CommentLoc =
-          SM.getDecomposedLoc(Tok.getLocation());
-      assert(CommentLoc.first == BeginLoc.first);
-      Comments.emplace_back(
-          Tok.getLocation(),
-          StringRef(Buffer.begin() + CommentLoc.second, Tok.getLength()));
-    }
+    if (Tok.is(tok::comment))
+      Comments.emplace_back(Tok.getLocation(),
+                            StringRef(SM.getCharacterData(Tok.getLocation()),
+                                      Tok.getLength()));
   }
 
   return Comments;
@@ -35,7 +35,11 @@ namespace clang {
 namespace {
 
 tok::TokenKind getTokenKind(SourceLocation Loc, const SourceManager &SM,
-                            const ASTContext *Context) {
+                            const ASTContext *Context,
+                            const tidy::TokenIndex &Tokens) {
+  if (Tokens.contains(Loc))
+    return Tokens.getTokenAt(Loc).getKind();
+
   Token Tok;
   SourceLocation Beginning =
       Lexer::GetBeginningOfToken(Loc, SM, Context->getLangOpts());
@@ -52,13 +56,23 @@ tok::TokenKind getTokenKind(SourceLocation Loc, const SourceManager &SM,
 SourceLocation
 forwardSkipWhitespaceAndComments(const SourceManager &SM,
                                  const clang::ASTContext *Context,
+                                 const tidy::TokenIndex &Tokens,
                                  SourceLocation Loc) {
+  if (Tokens.contains(Loc)) {
+    ArrayRef<Token> FileTokens = Tokens.tokens();
+    size_t I = Tokens.find(Loc);
+    // The last token is eof, which isn't a comment.
+    while (FileTokens[I].is(tok::comment))
+      ++I;
+    return FileTokens[I].getLocation();
+  }
+
   for (;;) {
     while (isWhitespace(*FullSourceLoc(Loc, SM).getCharacterData())) {
       Loc = Loc.getLocWithOffset(1);
     }
 
-    tok::TokenKind TokKind = getTokenKind(Loc, SM, Context);
+    tok::TokenKind TokKind = getTokenKind(Loc, SM, Context, Tokens);
     if (TokKind == tok::NUM_TOKENS || TokKind != tok::comment) {
       return Loc;
     }
@@ -78,11 +92,39 @@ StringRef getAsString(const SourceManager &SM, const clang::ASTContext *Context,
   return StringRef(Begin, End - Begin);
 }
 
+bool isTokenText(StringRef TokenText, StringRef Text) {
+  return TokenText == Text ||
+         (TokenText.back() == '>' &&
+          TokenText.substr(0, TokenText.size() - 1) == Text);
+}
+
 SourceRange findToken(const SourceManager &SM, const clang::ASTContext *Context,
-                      SourceRange SR, StringRef Text) {
+                      const tidy::TokenIndex &Tokens, SourceRange SR,
+                      StringRef Text) {
   if (SR.isInvalid())
     return SourceRange();
   assert(SR.isValid());
+  if (Tokens.contains(SR.getBegin()) && Tokens.contains(SR.getEnd())) {
+    ArrayRef<Token> FileTokens = Tokens.tokens();
+    unsigned EndOffset = Tokens.getOffset(SR.getEnd());
+    // As below, a token is looked at if the whitespace before it starts in
+    // the range.
+    unsigned Offset = Tokens.getOffset(SR.getBegin());
+    for (size_t I = Tokens.find(SR.getBegin());
+         Offset < EndOffset && FileTokens[I].isNot(tok::eof); ++I) {
+      const Token &Tok = FileTokens[I];
+      Offset = Tokens.getOffset(Tok.getLocation()) + Tok.getLength();
+      if (Tok.is(tok::comment))
+        continue;
+      StringRef TokenText(SM.getCharacterData(Tok.getLocation()),
+                          Tok.getLength());
+      if (isTokenText(TokenText, Text))
+        return SourceRange(Tok.getLocation(),
+                           Tok.getLocation().getLocWithOffset(Tok.getLength()));
+    }
+    return SourceRange();
+  }
+
   for (SourceLocation Loc = SR.getBegin(); Loc < SR.getEnd();) {
     // FIXME(mkurdej): Loc can actually be past SR.getEnd()
     while (isWhitespace(*FullSourceLoc(Loc, SM).getCharacterData())) {
@@ -92,9 +134,7 @@ SourceRange findToken(const SourceManager &SM, const clang::ASTContext *Context,
     SourceLocation EndLoc =
         Lexer::getLocForEndOfToken(Loc, 0, SM, Context->getLangOpts());
     StringRef TokenText = getAsString(SM, Context, SourceRange(Loc, EndLoc));
-    if (TokenText == Text ||
-        (TokenText.back() == '>' &&
-         TokenText.substr(0, TokenText.size() - 1) == Text))
+    if (isTokenText(TokenText, Text))
       return SourceRange(Loc, EndLoc);
     // fast-forward current token
     Loc = Lexer::getLocForEndOfToken(Loc, 0, SM, Context->getLangOpts());
@@ -105,8 +145,25 @@ SourceRange findToken(const SourceManager &SM, const clang::ASTContext *Context,
 
 SourceRange findTokenBackwards(const SourceManager &SM,
                                const clang::ASTContext *Context,
+                               const tidy::TokenIndex &Tokens,
                                SourceLocation Loc, StringRef Text) {
   assert(Loc.isValid());
+  if (Tokens.contains(Loc)) {
+    ArrayRef<Token> FileTokens = Tokens.tokens();
+    unsigned Offset = Tokens.getOffset(Loc);
+    for (size_t I = Tokens.find(Loc) + 1; I != 0; --I) {
+      const Token &Tok = FileTokens[I - 1];
+      if (Tok.is(tok::eof) || Tok.is(tok::comment) ||
+          Tokens.getOffset(Tok.getLocation()) > Offset)
+        continue;
+      if (StringRef(SM.getCharacterData(Tok.getLocation()), Tok.getLength()) ==
+          Text)
+        return SourceRange(Tok.getLocation(),
+                           Tok.getLocation().getLocWithOffset(Tok.getLength()));
+    }
+    return SourceRange();
+  }
+
   for (;;) {
     while (isWhitespace(*FullSourceLoc(Loc, SM).getCharacterData())) {
       Loc = Loc.getLocWithOffset(-1);
@@ -186,13 +243,13 @@ SourceRange getRangeAfterType(const SourceManager &SM,
 }
 
 SourceRange findQualifier(const SourceManager &SM, const ASTContext *Context,
-                          SourceRange LHS, SourceRange RHS,
-                          StringRef Qualifier) {
-  SourceRange LeftConstR = findToken(SM, Context, LHS, Qualifier);
+                          const tidy::TokenIndex &Tokens, SourceRange LHS,
+                          SourceRange RHS, StringRef Qualifier) {
+  SourceRange LeftConstR = findToken(SM, Context, Tokens, LHS, Qualifier);
   if (LeftConstR.isValid()) {
     return LeftConstR;
   }
-  return findToken(SM, Context, RHS, Qualifier);
+  return findToken(SM, Context, Tokens, RHS, Qualifier);
 }
 
 Qualifiers getInnerTypeQualifiers(TypeLoc TL) {
@@ -279,8 +336,10 @@ void QualifiersOrder::check(const MatchFinder::MatchResult &Result) {
     // Go past "typedef" keyword.
     SourceLocation PastTypedefLoc =
         Lexer::getLocForEndOfToken(R.getBegin(), 0, SM, Context->getLangOpts());
-    PastTypedefLoc =
-        forwardSkipWhitespaceAndComments(SM, Context, PastTypedefLoc);
+    PastTypedefLoc = forwardSkipWhitespaceAndComments(
+        SM, Context,
+        getTokenIndex(SM, SM.getFileID(R.getBegin()), Context->getLangOpts()),
+        PastTypedefLoc);
     R.setBegin(PastTypedefLoc);
     checkQualifiers(SM, Context, TD->getTypeSourceInfo()->getTypeLoc(), R);
   } else if (auto TSL = Result.Nodes.getStmtAs<TypeLoc>("template-spec-loc")) {
@@ -297,6 +356,8 @@ void QualifiersOrder::check(const MatchFinder::MatchResult &Result) {
     if (StartLoc.isInvalid() || StartLoc.isMacroID())
       return;
     StartLoc = StartLoc.getLocWithOffset(1);
+    const TokenIndex &Tokens =
+        getTokenIndex(SM, SM.getFileID(StartLoc), Context->getLangOpts());
     for (unsigned int Arg = 0; Arg < NumArgs - 1; ++Arg) {
       TemplateArgumentLoc TAL = TSTL.getArgLoc(Arg);
       TemplateArgumentLoc NextTAL = TSTL.getArgLoc(Arg + 1);
@@ -304,9 +365,9 @@ void QualifiersOrder::check(const MatchFinder::MatchResult &Result) {
       if (EndLoc.isMacroID())
         continue;
       // Find a comma ',' going backwards, because EndLoc overlaps the next TAL.
-      EndLoc = findTokenBackwards(SM, Context, EndLoc, ",").getBegin();
+      EndLoc = findTokenBackwards(SM, Context, Tokens, EndLoc, ",").getBegin();
       SourceLocation NewEndLoc = forwardSkipWhitespaceAndComments(
-          SM, Context, EndLoc.getLocWithOffset(1));
+          SM, Context, Tokens, EndLoc.getLocWithOffset(1));
       if (TAL.getArgument().getKind() != TemplateArgument::Type) {
         StartLoc = NewEndLoc;
         continue;
@@ -340,16 +401,19 @@ void QualifiersOrder::checkQualifiers(const SourceManager &SM,
     return;
 
   // Find const qualifier of the inner (leftmost) type.
+  const TokenIndex &Tokens =
+      getTokenIndex(SM, SM.getFileID(R.getBegin()), Context->getLangOpts());
   SourceRange LHS = getRangeBeforeType(TL, R.getBegin());
   SourceRange RHS = getRangeAfterType(SM, Context, TL, R.getEnd());
-  SourceRange ConstR = findQualifier(SM, Context, LHS, RHS, "const");
+  SourceRange ConstR = findQualifier(SM, Context, Tokens, LHS, RHS, "const");
   if (ConstR.isInvalid()) {
     // It happens when const comes from a macro expansion.
     return;
   }
 
   // Skip whitespace and comments following const.
-  ConstR.setEnd(forwardSkipWhitespaceAndComments(SM, Context, ConstR.getEnd()));
+  ConstR.setEnd(
+      forwardSkipWhitespaceAndComments(SM, Context, Tokens, ConstR.getEnd()));
 
   // Define insert location, respectively, left and right to the type.
   SourceLocation InsertLoc;
@@ -23,6 +23,8 @@ public:
       : ClangTidyCheck(Name, Context) {}
   void registerMatchers(ast_matchers::MatchFinder *Finder) override;
   void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
+  bool isLocationLocal() const override { return true; }
+  bool isReusable() const override { return true; }
 };
 
 } // namespace tidy
@@ -21,23 +21,22 @@ void UseOverride::registerMatchers(MatchFinder *Finder) {
   Finder->addMatcher(methodDecl(isOverride()).bind("method"), this);
 }
 
-// Re-lex the tokens to get precise locations to insert 'override' and remove
-// 'virtual'.
+// Get the tokens of the declaration to find precise locations to insert
+// 'override' and remove 'virtual'.
 static SmallVector<Token, 16> ParseTokens(CharSourceRange Range,
-                                          const SourceManager &Sources,
-                                          LangOptions LangOpts) {
-  std::pair<FileID, unsigned> LocInfo =
-      Sources.getDecomposedLoc(Range.getBegin());
-  StringRef File = Sources.getBufferData(LocInfo.first);
-  const char *TokenBegin = File.data() + LocInfo.second;
-  Lexer RawLexer(Sources.getLocForStartOfFile(LocInfo.first), LangOpts,
-                 File.begin(), TokenBegin, File.end());
+                                          const TokenIndex &Index) {
   SmallVector<Token, 16> Tokens;
-  Token Tok;
-  while (!RawLexer.LexFromRawLexer(Tok)) {
-    if (Tok.is(tok::semi) || Tok.is(tok::l_brace))
+  if (!Index.contains(Range.getBegin()) || !Index.contains(Range.getEnd()))
+    return Tokens;
+  unsigned EndOffset = Index.getOffset(Range.getEnd());
+  ArrayRef<Token> FileTokens = Index.tokens();
+  for (size_t I = Index.find(Range.getBegin()); I != FileTokens.size(); ++I) {
+    const Token &Tok = FileTokens[I];
+    if (Tok.is(tok::comment))
+      continue;
+    if (Tok.is(tok::eof) || Tok.is(tok::semi) || Tok.is(tok::l_brace))
       break;
-    if (Sources.isBeforeInTranslationUnit(Range.getEnd(), Tok.getLocation()))
+    if (Index.getOffset(Tok.getLocation()) > EndOffset)
       break;
     Tokens.push_back(Tok);
   }
@@ -87,8 +86,9 @@ void UseOverride::check(const MatchFinder::MatchResult &Result) {
   // FIXME: Instead of re-lexing and looking for specific macros such as
   // 'ABSTRACT', properly store the location of 'virtual' and '= 0' in each
   // FunctionDecl.
-  SmallVector<Token, 16> Tokens = ParseTokens(FileRange, Sources,
-                                              Result.Context->getLangOpts());
+  SmallVector<Token, 16> Tokens = ParseTokens(
+      FileRange, getTokenIndex(Sources, Sources.getFileID(FileRange.getBegin()),
+                               Result.Context->getLangOpts()));
 
   // Add 'override' on inline declarations that don't already have it.
   if (!HasFinal && !HasOverride) {
@@ -20,7 +20,11 @@ namespace readability {
 namespace {
 
 tok::TokenKind getTokenKind(SourceLocation Loc, const SourceManager &SM,
-                            const ASTContext *Context) {
+                            const ASTContext *Context,
+                            const TokenIndex &Tokens) {
+  if (Tokens.contains(Loc))
+    return Tokens.getTokenAt(Loc).getKind();
+
   Token Tok;
   SourceLocation Beginning =
       Lexer::GetBeginningOfToken(Loc, SM, Context->getLangOpts());
@@ -36,13 +40,23 @@ tok::TokenKind getTokenKind(SourceLocation Loc, const SourceManager &SM,
 
 SourceLocation forwardSkipWhitespaceAndComments(SourceLocation Loc,
                                                 const SourceManager &SM,
-                                                const ASTContext *Context) {
+                                                const ASTContext *Context,
+                                                const TokenIndex &Tokens) {
   assert(Loc.isValid());
+  if (Tokens.contains(Loc)) {
+    ArrayRef<Token> FileTokens = Tokens.tokens();
+    size_t I = Tokens.find(Loc);
+    // The last token is eof, which isn't a comment.
+    while (FileTokens[I].is(tok::comment))
+      ++I;
+    return FileTokens[I].getLocation();
+  }
+
   for (;;) {
     while (isWhitespace(*FullSourceLoc(Loc, SM).getCharacterData()))
       Loc = Loc.getLocWithOffset(1);
 
-    tok::TokenKind TokKind = getTokenKind(Loc, SM, Context);
+    tok::TokenKind TokKind = getTokenKind(Loc, SM, Context, Tokens);
     if (TokKind == tok::NUM_TOKENS || TokKind != tok::comment)
       return Loc;
 
@@ -53,13 +67,14 @@ SourceLocation forwardSkipWhitespaceAndComments(SourceLocation Loc,
 
 SourceLocation findEndLocation(SourceLocation LastTokenLoc,
                                const SourceManager &SM,
-                               const ASTContext *Context) {
+                               const ASTContext *Context,
+                               const TokenIndex &Tokens) {
   SourceLocation Loc = LastTokenLoc;
   // Loc points to the beginning of the last (non-comment non-ws) token
   // before end or ';'.
   assert(Loc.isValid());
   bool SkipEndWhitespaceAndComments = true;
-  tok::TokenKind TokKind = getTokenKind(Loc, SM, Context);
+  tok::TokenKind TokKind = getTokenKind(Loc, SM, Context, Tokens);
   if (TokKind == tok::NUM_TOKENS || TokKind == tok::semi ||
       TokKind == tok::r_brace) {
     // If we are at ";" or "}", we found the last token. We could use as well
@@ -71,8 +86,8 @@ SourceLocation findEndLocation(SourceLocation LastTokenLoc,
   // Loc points past the last token before end or after ';'.
 
   if (SkipEndWhitespaceAndComments) {
-    Loc = forwardSkipWhitespaceAndComments(Loc, SM, Context);
-    tok::TokenKind TokKind = getTokenKind(Loc, SM, Context);
+    Loc = forwardSkipWhitespaceAndComments(Loc, SM, Context, Tokens);
+    tok::TokenKind TokKind = getTokenKind(Loc, SM, Context, Tokens);
     if (TokKind == tok::semi)
       Loc = Lexer::getLocForEndOfToken(Loc, 0, SM, Context->getLangOpts());
   }
@@ -86,7 +101,7 @@ SourceLocation findEndLocation(SourceLocation LastTokenLoc,
       // EOL, insert brace before.
       break;
     }
-    tok::TokenKind TokKind = getTokenKind(Loc, SM, Context);
+    tok::TokenKind TokKind = getTokenKind(Loc, SM, Context, Tokens);
     if (TokKind != tok::comment) {
       // Non-comment token, insert brace before.
       break;
@@ -179,6 +194,8 @@ BracesAroundStatementsCheck::findRParenLoc(const IfOrWhileStmt *S,
     CondEndLoc = CondVar->getLocEnd();
 
   assert(CondEndLoc.isValid());
+  const TokenIndex &Tokens = getTokenIndex(SM, SM.getFileID(CondEndLoc),
+                                           Context->getLangOpts());
   SourceLocation PastCondEndLoc =
       Lexer::getLocForEndOfToken(CondEndLoc, 0, SM, Context->getLangOpts());
   if (PastCondEndLoc.isInvalid()) {
@@ -186,12 +203,12 @@ BracesAroundStatementsCheck::findRParenLoc(const IfOrWhileStmt *S,
     return SourceLocation();
   }
   SourceLocation RParenLoc =
-      forwardSkipWhitespaceAndComments(PastCondEndLoc, SM, Context);
+      forwardSkipWhitespaceAndComments(PastCondEndLoc, SM, Context, Tokens);
   if (RParenLoc.isInvalid()) {
     diag(PastCondEndLoc, ErrorMessage);
     return SourceLocation();
   }
-  tok::TokenKind TokKind = getTokenKind(RParenLoc, SM, Context);
+  tok::TokenKind TokKind = getTokenKind(RParenLoc, SM, Context, Tokens);
   if (TokKind != tok::r_paren) {
     diag(RParenLoc, ErrorMessage);
     return SourceLocation();
@@ -232,7 +249,9 @@ BracesAroundStatementsCheck::checkStmt(const MatchFinder::MatchResult &Result,
     EndLoc = EndLocHint;
     ClosingInsertion = "} ";
   } else {
-    EndLoc = findEndLocation(S->getLocEnd(), SM, Context);
+    const TokenIndex &Tokens = getTokenIndex(SM, SM.getFileID(S->getLocEnd()),
+                                             Context->getLangOpts());
+    EndLoc = findEndLocation(S->getLocEnd(), SM, Context, Tokens);
     ClosingInsertion = "\n}";
   }
 
@@ -8,6 +8,8 @@
 //===----------------------------------------------------------------------===//
 
 #include "FunctionSize.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/RecursiveASTVisitor.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
 
 using namespace clang::ast_matchers;
@@ -16,6 +18,70 @@ namespace clang {
 namespace tidy {
 namespace readability {
 
+namespace {
+
+/// \brief Counts the statements and branches of a function, including those
+/// of the lambdas and local classes it contains, in a single walk.
+///
+/// A statement is counted if it isn't a block and its parent is a block or a
+/// loop or \c if statement. If, loop, case, default and goto statements are
+/// counted as branches wherever they are.
+class FunctionASTVisitor : public RecursiveASTVisitor<FunctionASTVisitor> {
+  typedef RecursiveASTVisitor<FunctionASTVisitor> Base;
+
+public:
+  FunctionASTVisitor() : Statements(0), Branches(0), Parent(nullptr) {}
+
+  bool shouldVisitTemplateInstantiations() const { return true; }
+  bool shouldVisitImplicitCode() const { return true; }
+  // Data recursion would bypass TraverseStmt() for some children.
+  bool shouldUseDataRecursionFor(Stmt * /*S*/) const { return false; }
+
+  bool TraverseStmt(Stmt *S) {
+    if (!S)
+      return true;
+    if (Parent && !isa<CompoundStmt>(S) && countsChildren(Parent))
+      ++Statements;
+    if (isBranch(S))
+      ++Branches;
+
+    Stmt *SavedParent = Parent;
+    Parent = S;
+    Base::TraverseStmt(S);
+    Parent = SavedParent;
+    return true;
+  }
+
+  // The statements of declarations, e.g. the body of a lambda, have no parent
+  // statement.
+  bool TraverseDecl(Decl *D) {
+    Stmt *SavedParent = Parent;
+    Parent = nullptr;
+    Base::TraverseDecl(D);
+    Parent = SavedParent;
+    return true;
+  }
+
+  unsigned Statements;
+  unsigned Branches;
+
+private:
+  static bool countsChildren(const Stmt *S) {
+    return isa<CompoundStmt>(S) || isa<IfStmt>(S) || isa<WhileStmt>(S) ||
+           isa<DoStmt>(S) || isa<CXXForRangeStmt>(S) || isa<ForStmt>(S);
+  }
+
+  static bool isBranch(const Stmt *S) {
+    return isa<IfStmt>(S) || isa<WhileStmt>(S) || isa<DoStmt>(S) ||
+           isa<ForStmt>(S) || isa<CXXForRangeStmt>(S) || isa<SwitchCase>(S) ||
+           isa<GotoStmt>(S) || isa<IndirectGotoStmt>(S);
+  }
+
+  Stmt *Parent;
+};
+
+} // namespace
+
 FunctionSizeCheck::FunctionSizeCheck(StringRef Name, ClangTidyContext *Context)
     : ClangTidyCheck(Name, Context),
       LineThreshold(Options.get("LineThreshold", -1U)),
@@ -30,75 +96,54 @@ void FunctionSizeCheck::storeOptions(ClangTidyOptions::OptionMap &Opts) {
 
 void FunctionSizeCheck::registerMatchers(MatchFinder *Finder) {
   Finder->addMatcher(
-      functionDecl(
-          unless(isInstantiated()),
-          forEachDescendant(
-              stmt(unless(compoundStmt()),
-                   hasParent(stmt(anyOf(compoundStmt(), ifStmt(),
-                                        anyOf(whileStmt(), doStmt(),
-                                              forRangeStmt(), forStmt())))))
-                  .bind("stmt"))).bind("func"),
+      functionDecl(unless(isInstantiated()), isDefinition()).bind("func"),
       this);
 }
 
 void FunctionSizeCheck::check(const MatchFinder::MatchResult &Result) {
   const auto *Func = Result.Nodes.getNodeAs<FunctionDecl>("func");
 
-  FunctionInfo &FI = FunctionInfos[Func];
+  FunctionASTVisitor Visitor;
+  Visitor.TraverseDecl(const_cast<FunctionDecl *>(Func));
+  // Functions without statements are never reported.
+  if (!Visitor.Statements)
+    return;
 
   // Count the lines including whitespace and comments. Really simple.
-  if (!FI.Lines) {
-    if (const Stmt *Body = Func->getBody()) {
-      SourceManager *SM = Result.SourceManager;
-      if (SM->isWrittenInSameFile(Body->getLocStart(), Body->getLocEnd())) {
-        FI.Lines = SM->getSpellingLineNumber(Body->getLocEnd()) -
-                   SM->getSpellingLineNumber(Body->getLocStart());
-      }
+  unsigned Lines = 0;
+  if (const Stmt *Body = Func->getBody()) {
+    SourceManager *SM = Result.SourceManager;
+    if (SM->isWrittenInSameFile(Body->getLocStart(), Body->getLocEnd())) {
+      Lines = SM->getSpellingLineNumber(Body->getLocEnd()) -
+              SM->getSpellingLineNumber(Body->getLocStart());
     }
   }
 
-  const auto *Statement = Result.Nodes.getNodeAs<Stmt>("stmt");
-  ++FI.Statements;
-
-  // TODO: switch cases, gotos
-  if (isa<IfStmt>(Statement) || isa<WhileStmt>(Statement) ||
-      isa<ForStmt>(Statement) || isa<SwitchStmt>(Statement) ||
-      isa<DoStmt>(Statement) || isa<CXXForRangeStmt>(Statement))
-    ++FI.Branches;
-}
-
-void FunctionSizeCheck::onEndOfTranslationUnit() {
   // If we're above the limit emit a warning.
-  for (const auto &P : FunctionInfos) {
-    const FunctionInfo &FI = P.second;
-    if (FI.Lines > LineThreshold || FI.Statements > StatementThreshold ||
-        FI.Branches > BranchThreshold) {
-      diag(P.first->getLocation(),
-           "function '%0' exceeds recommended size/complexity thresholds")
-          << P.first->getNameAsString();
-    }
-
-    if (FI.Lines > LineThreshold) {
-      diag(P.first->getLocation(),
-           "%0 lines including whitespace and comments (threshold %1)",
-           DiagnosticIDs::Note)
-          << FI.Lines << LineThreshold;
-    }
+  if (Lines > LineThreshold || Visitor.Statements > StatementThreshold ||
+      Visitor.Branches > BranchThreshold) {
+    diag(Func->getLocation(),
+         "function '%0' exceeds recommended size/complexity thresholds")
+        << Func->getNameAsString();
+  }
 
-    if (FI.Statements > StatementThreshold) {
-      diag(P.first->getLocation(), "%0 statements (threshold %1)",
-           DiagnosticIDs::Note)
-          << FI.Statements << StatementThreshold;
-    }
+  if (Lines > LineThreshold) {
+    diag(Func->getLocation(),
+         "%0 lines including whitespace and comments (threshold %1)",
+         DiagnosticIDs::Note)
+        << Lines << LineThreshold;
+  }
 
-    if (FI.Branches > BranchThreshold) {
-      diag(P.first->getLocation(), "%0 branches (threshold %1)",
-           DiagnosticIDs::Note)
-          << FI.Branches << BranchThreshold;
-    }
+  if (Visitor.Statements > StatementThreshold) {
+    diag(Func->getLocation(), "%0 statements (threshold %1)",
+         DiagnosticIDs::Note)
+        << Visitor.Statements << StatementThreshold;
   }
 
-  FunctionInfos.clear();
+  if (Visitor.Branches > BranchThreshold) {
+    diag(Func->getLocation(), "%0 branches (threshold %1)", DiagnosticIDs::Note)
+        << Visitor.Branches << BranchThreshold;
+  }
 }
 
 } // namespace readability
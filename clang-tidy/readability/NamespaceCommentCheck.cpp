@@ -10,7 +10,6 @@
 #include "NamespaceCommentCheck.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchers.h"
-#include "clang/Lex/Lexer.h"
 #include "llvm/ADT/StringExtras.h"
 
 using namespace clang::ast_matchers;
@@ -68,14 +67,13 @@ void NamespaceCommentCheck::check(const MatchFinder::MatchResult &Result) {
 
   // Find next token after the namespace closing brace.
   SourceLocation AfterRBrace = ND->getRBraceLoc().getLocWithOffset(1);
-  SourceLocation Loc = AfterRBrace;
-  Token Tok;
-  // Skip whitespace until we find the next token.
-  while (Lexer::getRawToken(Loc, Tok, Sources, Result.Context->getLangOpts())) {
-    Loc = Loc.getLocWithOffset(1);
-  }
-  if (!locationsInSameFile(Sources, ND->getRBraceLoc(), Loc))
+  const TokenIndex &Index =
+      getTokenIndex(Sources, Sources.getFileID(ND->getRBraceLoc()),
+                    Result.Context->getLangOpts());
+  if (!Index.contains(AfterRBrace))
     return;
+  const Token &Tok = Index.getTokenAt(AfterRBrace);
+  SourceLocation Loc = Tok.getLocation();
 
   bool NextTokenIsOnSameLine = Sources.getSpellingLineNumber(Loc) == EndLine;
   // If we insert a line comment before the token in the same line, we need
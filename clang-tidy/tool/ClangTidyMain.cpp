@@ -78,6 +78,42 @@ LineFilter("line-filter",
                     "  ]"),
            cl::init(""), cl::cat(ClangTidyCategory));
 
+static cl::opt<bool> SkipCheckedHeaders(
+    "skip-checked-headers",
+    cl::desc("Don't report diagnostics again in headers\n"
+             "that were checked by an earlier translation\n"
+             "unit with the same options. Diagnostics that\n"
+             "depend on the including file may be lost: a\n"
+             "header whose contents depend on macros defined\n"
+             "by each translation unit loses the warnings of\n"
+             "all but the first one. Can't be combined with\n"
+             "-cache-dir."),
+    cl::init(false), cl::cat(ClangTidyCategory));
+
+static cl::opt<bool> SkipFilteredCode(
+    "skip-filtered-code",
+    cl::desc("Don't run location-local checks on code whose\n"
+             "warnings are never displayed: system headers,\n"
+             "headers not matching -header-filter and files\n"
+             "excluded by -line-filter. Warnings with notes in\n"
+             "displayed code may be lost."),
+    cl::init(false), cl::cat(ClangTidyCategory));
+
+static cl::opt<CheckCostClass> MaxCheckCost(
+    "max-check-cost",
+    cl::desc("Only run the enabled checks up to this cost\n"
+             "class, e.g. for quick runs in an editor."),
+    cl::values(clEnumValN(CCC_Lexical, "lexical",
+                          "checks of tokens and directives only"),
+               clEnumValN(CCC_ASTLocal, "ast-local",
+                          "checks of single AST nodes too"),
+               clEnumValN(CCC_WholeTranslationUnit, "whole-tu",
+                          "checks of whole translation units too"),
+               clEnumValN(CCC_PathSensitive, "path-sensitive",
+                          "all checks, including the static analyzer"),
+               clEnumValEnd),
+    cl::init(CCC_PathSensitive), cl::cat(ClangTidyCategory));
+
 static cl::opt<bool> Fix("fix", cl::desc("Fix detected errors if possible."),
                          cl::init(false), cl::cat(ClangTidyCategory));
 
@@ -106,6 +142,22 @@ static cl::opt<bool> EnableCheckProfile(
     cl::desc("Enable per-check timing profiles, and print a report to stderr."),
     cl::init(false), cl::cat(ClangTidyCategory));
 
+static cl::opt<std::string> ExportProfile(
+    "export-profile",
+    cl::desc("JSON file to store the parse, matcher and\n"
+             "analyzer times and the time of each check of\n"
+             "each translation unit in, along with the peak\n"
+             "memory use of the whole process once it was\n"
+             "processed."),
+    cl::value_desc("file"), cl::cat(ClangTidyCategory));
+
+static cl::opt<bool> ExportProfileTrace(
+    "export-profile-trace",
+    cl::desc("Store the profile exported with -export-profile\n"
+             "in the Chrome trace event format, which can be\n"
+             "loaded in chrome://tracing."),
+    cl::init(false), cl::cat(ClangTidyCategory));
+
 static cl::opt<bool> AnalyzeTemporaryDtors(
     "analyze-temporary-dtors",
     cl::desc("Enable temporary destructor-aware analysis in\n"
@@ -114,16 +166,81 @@ static cl::opt<bool> AnalyzeTemporaryDtors(
              ".clang-tidy file."),
     cl::init(false), cl::cat(ClangTidyCategory));
 
+static cl::opt<unsigned> AnalyzerMaxNodes(
+    "analyzer-max-nodes",
+    cl::desc("Maximum number of nodes the clang-analyzer-\n"
+             "checks explore in each function. Paths not\n"
+             "explored when it is reached are dropped.\n"
+             "This option overrides the value read from a\n"
+             ".clang-tidy file."),
+    cl::value_desc("n"), cl::cat(ClangTidyCategory));
+
+static cl::opt<unsigned> NumThreads(
+    "j",
+    cl::desc("Number of translation units to process in parallel.\n"
+             "0 means the number of hardware threads."),
+    cl::init(1), cl::value_desc("N"), cl::cat(ClangTidyCategory));
+
 static cl::opt<std::string> ExportFixes(
     "export-fixes",
     cl::desc("YAML file to store suggested fixes in. The\n"
              "stored fixes can be applied to the input source\n"
-             "code with clang-apply-replacements."),
+             "code with clang-apply-replacements. The fixes of\n"
+             "each file are written as soon as it is processed."),
     cl::value_desc("filename"), cl::cat(ClangTidyCategory));
 
+static cl::opt<bool> ExportFixesBinary(
+    "export-fixes-binary",
+    cl::desc("Store the fixes exported with -export-fixes in a\n"
+             "compact binary format instead of YAML. The file\n"
+             "is recognized by clang-apply-replacements."),
+    cl::init(false), cl::cat(ClangTidyCategory));
+
+static cl::opt<std::string> CacheDir(
+    "cache-dir",
+    cl::desc("Directory in which to cache the results of each\n"
+             "translation unit. Translation units whose sources,\n"
+             "compile commands and options didn't change are not\n"
+             "processed again."),
+    cl::value_desc("directory"), cl::cat(ClangTidyCategory));
+
+static cl::opt<bool> ReusePreambles(
+    "reuse-preambles",
+    cl::desc("Build a precompiled header for the leading\n"
+             "block of includes shared by several source\n"
+             "files with the same compile command, and use it\n"
+             "instead of parsing these includes again. Not\n"
+             "done if it could change the results, e.g. for\n"
+             "checks that inspect preprocessor directives."),
+    cl::init(false), cl::cat(ClangTidyCategory));
+
 namespace clang {
 namespace tidy {
 
+namespace {
+/// \brief Passes the errors it receives to several sinks, in order.
+class ErrorSinks : public ClangTidyErrorSink {
+public:
+  void add(std::unique_ptr<ClangTidyErrorSink> Sink) {
+    Sinks.push_back(std::move(Sink));
+  }
+
+  void handleErrors(StringRef MainFile,
+                    ArrayRef<ClangTidyError> Errors) override {
+    for (const auto &Sink : Sinks)
+      Sink->handleErrors(MainFile, Errors);
+  }
+
+  void finish() override {
+    for (const auto &Sink : Sinks)
+      Sink->finish();
+  }
+
+private:
+  std::vector<std::unique_ptr<ClangTidyErrorSink>> Sinks;
+};
+} // namespace
+
 static void printStats(const ClangTidyStats &Stats) {
   if (Stats.errorsIgnored()) {
     llvm::errs() << "Suppressed " << Stats.errorsIgnored() << " warnings (";
@@ -137,6 +254,11 @@ static void printStats(const ClangTidyStats &Stats) {
                    << " due to line filter";
       Separator = ", ";
     }
+    if (Stats.ErrorsIgnoredCheckedHeader) {
+      llvm::errs() << Separator << Stats.ErrorsIgnoredCheckedHeader
+                   << " in checked headers";
+      Separator = ", ";
+    }
     if (Stats.ErrorsIgnoredNOLINT) {
       llvm::errs() << Separator << Stats.ErrorsIgnoredNOLINT << " NOLINT";
       Separator = ", ";
@@ -149,6 +271,12 @@ static void printStats(const ClangTidyStats &Stats) {
       llvm::errs() << "Use -header-filter='.*' to display errors from all "
                       "non-system headers.\n";
   }
+  if (Stats.CacheHits || Stats.CacheMisses)
+    llvm::errs() << "Cache: " << Stats.CacheHits << " hits, "
+                 << Stats.CacheMisses << " misses.\n";
+  if (Stats.PreamblesBuilt)
+    llvm::errs() << "Preambles: " << Stats.PreamblesBuilt << " built, "
+                 << Stats.PreamblesReused << " reused.\n";
 }
 
 static void printProfileData(const ProfileData &Profile,
@@ -197,6 +325,9 @@ std::unique_ptr<ClangTidyOptionsProvider> createOptionsProvider() {
     llvm::cl::PrintHelpMessage(/*Hidden=*/false, /*Categorized=*/true);
     return nullptr;
   }
+  GlobalOptions.SkipCheckedHeaders = SkipCheckedHeaders;
+  GlobalOptions.SkipFilteredCode = SkipFilteredCode;
+  GlobalOptions.MaxCheckCost = MaxCheckCost;
 
   ClangTidyOptions DefaultOptions;
   DefaultOptions.Checks = DefaultChecks;
@@ -217,6 +348,8 @@ std::unique_ptr<ClangTidyOptionsProvider> createOptionsProvider() {
     OverrideOptions.SystemHeaders = SystemHeaders;
   if (AnalyzeTemporaryDtors.getNumOccurrences() > 0)
     OverrideOptions.AnalyzeTemporaryDtors = AnalyzeTemporaryDtors;
+  if (AnalyzerMaxNodes.getNumOccurrences() > 0)
+    OverrideOptions.AnalyzerMaxNodes = AnalyzerMaxNodes;
 
   if (!Config.empty()) {
     if (llvm::ErrorOr<ClangTidyOptions> ParsedConfig =
@@ -270,25 +403,51 @@ int clangTidyMain(int argc, const char **argv) {
     return 1;
   }
 
-  ProfileData Profile;
+  // A cache entry has to hold all errors of its translation unit, including
+  // the ones in headers checked by another one.
+  if (SkipCheckedHeaders && !CacheDir.empty()) {
+    llvm::errs() << "Error: -skip-checked-headers can't be used with "
+                    "-cache-dir.\n";
+    return 1;
+  }
 
-  std::vector<ClangTidyError> Errors;
-  ClangTidyStats Stats =
-      runClangTidy(std::move(OptionsProvider), OptionsParser.getCompilations(),
-                   OptionsParser.getSourcePathList(), &Errors,
-                   EnableCheckProfile ? &Profile : nullptr);
-  handleErrors(Errors, Fix);
+  ProfileData Profile;
+  bool EnableProfile = EnableCheckProfile || !ExportProfile.empty();
 
-  if (!ExportFixes.empty() && !Errors.empty()) {
+  std::unique_ptr<llvm::raw_fd_ostream> ProfileOS;
+  if (!ExportProfile.empty()) {
     std::error_code EC;
-    llvm::raw_fd_ostream OS(ExportFixes, EC, llvm::sys::fs::F_None);
+    ProfileOS.reset(
+        new llvm::raw_fd_ostream(ExportProfile, EC, llvm::sys::fs::F_None));
     if (EC) {
       llvm::errs() << "Error opening output file: " << EC.message() << '\n';
       return 1;
     }
-    exportReplacements(Errors, OS);
   }
 
+  // Errors are displayed and fixes exported as soon as each file is done.
+  ErrorSinks Sinks;
+  Sinks.add(createErrorReporter(Fix));
+  std::error_code FixesEC;
+  if (!ExportFixes.empty())
+    Sinks.add(
+        createReplacementsExporter(ExportFixes, ExportFixesBinary, FixesEC));
+
+  ClangTidyStats Stats =
+      runClangTidy(std::move(OptionsProvider), OptionsParser.getCompilations(),
+                   OptionsParser.getSourcePathList(), Sinks,
+                   EnableProfile ? &Profile : nullptr, NumThreads,
+                   CacheDir, ReusePreambles);
+
+  if (FixesEC) {
+    llvm::errs() << "Error writing output file: " << FixesEC.message()
+                 << '\n';
+    return 1;
+  }
+
+  if (ProfileOS)
+    exportProfile(Profile, *ProfileOS, ExportProfileTrace);
+
   printStats(Stats);
   if (EnableCheckProfile)
     printProfileData(Profile, llvm::errs());
@@ -21,6 +21,7 @@ public:
   HeaderGuardCheck(StringRef Name, ClangTidyContext *Context)
       : ClangTidyCheck(Name, Context) {}
   void registerPPCallbacks(CompilerInstance &Compiler) override;
+  CheckCostClass getCostClass() const override { return CCC_Lexical; }
 
   /// \brief Returns true if the checker should suggest inserting a trailing
   /// comment on the #endif of the header guard. It will use the same name as
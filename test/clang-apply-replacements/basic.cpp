@@ -5,6 +5,11 @@
 // RUN: clang-apply-replacements %T/Inputs/basic
 // RUN: FileCheck -input-file=%T/Inputs/basic/basic.h %S/Inputs/basic/basic.h
 //
+// Check that reading the yaml files in parallel gives the same result.
+// RUN: grep -Ev "// *[A-Z-]+:" %S/Inputs/basic/basic.h > %T/Inputs/basic/basic.h
+// RUN: clang-apply-replacements -j 2 %T/Inputs/basic
+// RUN: FileCheck -input-file=%T/Inputs/basic/basic.h %S/Inputs/basic/basic.h
+//
 // Check that the yaml files are *not* deleted after running clang-apply-replacements without remove-change-desc-files.
 // RUN: ls -1 %T/Inputs/basic | FileCheck %s --check-prefix=YAML
 //
@@ -4,6 +4,19 @@
 // RUN: FileCheck -input-file=%t.cpp %s
 // RUN: clang-modernize -loop-convert -use-nullptr -risk=risky %t_risky.cpp -- -std=c++11
 // RUN: FileCheck -check-prefix=RISKY -input-file=%t_risky.cpp %s
+// RUN: grep -Ev "// *[A-Z-]+:" %s > %t_single.cpp
+// RUN: clang-modernize -single-parse -loop-convert -use-nullptr %t_single.cpp -- -std=c++11
+// RUN: FileCheck -input-file=%t_single.cpp %s
+// RUN: grep -Ev "// *[A-Z-]+:" %s > %t_j1.cpp
+// RUN: grep -Ev "// *[A-Z-]+:" %s > %t_j2.cpp
+// RUN: clang-modernize -j 2 -loop-convert -use-nullptr %t_j1.cpp %t_j2.cpp -- -std=c++11
+// RUN: FileCheck -input-file=%t_j1.cpp %s
+// RUN: FileCheck -input-file=%t_j2.cpp %s
+// RUN: grep -Ev "// *[A-Z-]+:" %s > %t_single_j1.cpp
+// RUN: grep -Ev "// *[A-Z-]+:" %s > %t_single_j2.cpp
+// RUN: clang-modernize -j 2 -single-parse -loop-convert -use-nullptr %t_single_j1.cpp %t_single_j2.cpp -- -std=c++11
+// RUN: FileCheck -input-file=%t_single_j1.cpp %s
+// RUN: FileCheck -input-file=%t_single_j2.cpp %s
 
 #define NULL 0
 
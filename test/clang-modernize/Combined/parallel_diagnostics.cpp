@@ -0,0 +1,17 @@
+// RUN: echo 'int a = undeclared_a;' > %t_a.cpp
+// RUN: echo 'int b = undeclared_b;' > %t_b.cpp
+// RUN: echo 'int c = undeclared_c;' > %t_c.cpp
+// RUN: not clang-modernize -j 2 -use-nullptr %t_a.cpp %t_b.cpp %t_c.cpp -- -std=c++11 2>&1 | FileCheck %s
+
+// The diagnostics of the sources processed in parallel are printed in the
+// order of the sources.
+// CHECK: _a.cpp:1:9: error: use of undeclared identifier 'undeclared_a'
+// CHECK-NEXT: int a = undeclared_a;
+// CHECK: Error while processing {{.*}}_a.cpp.
+// CHECK: _b.cpp:1:9: error: use of undeclared identifier 'undeclared_b'
+// CHECK-NEXT: int b = undeclared_b;
+// CHECK: Error while processing {{.*}}_b.cpp.
+// CHECK: _c.cpp:1:9: error: use of undeclared identifier 'undeclared_c'
+// CHECK-NEXT: int c = undeclared_c;
+// CHECK: Error while processing {{.*}}_c.cpp.
+// CHECK-NEXT: Error encountered during translation.
@@ -0,0 +1,21 @@
+// RUN: grep -Ev "// *[A-Z-]+:" %s > %t.cpp
+// RUN: clang-modernize -single-parse -loop-convert -use-auto %t.cpp -- -std=c++11 -I %S/../UseAuto/Inputs 2> %t.err
+// RUN: FileCheck -input-file=%t.cpp %s
+// RUN: FileCheck -check-prefix=ERR -input-file=%t.err %s
+//
+// Both transforms rewrite the declaration of the loop iterator. Their
+// replacements overlap, so the source is transformed one transform at a time.
+// ERR: Replacements of different transforms overlap in 1 source(s)
+
+#define CONTAINER vector
+#include "test_std_container.h"
+#undef CONTAINER
+
+int sum(std::vector<int> &Vec) {
+  int Sum = 0;
+  for (std::vector<int>::iterator I = Vec.begin(); I != Vec.end(); ++I)
+    Sum += *I;
+  // CHECK: for (auto {{.*}}elem : Vec)
+  // CHECK-NEXT: Sum += elem;
+  return Sum;
+}
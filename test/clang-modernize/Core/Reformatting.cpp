@@ -2,13 +2,13 @@
 // RUN: clang-modernize -format -use-auto %t.cpp
 // RUN: FileCheck --strict-whitespace -input-file=%t.cpp %s
 
-// Ensure that -style is forwarded to clang-apply-replacements by using a style
+// Ensure that -style is honored when applying replacements by using a style
 // other than LLVM and ensuring the result is styled as requested.
 // RUN: grep -Ev "// *[A-Z-]+:" %s > %t.cpp
 // RUN: clang-modernize -format -style=Google -use-nullptr %t.cpp
 // RUN: FileCheck --check-prefix=Google --strict-whitespace -input-file=%t.cpp %s
 
-// Ensure -style-config is forwarded to clang-apply-replacements. The .clang-format
+// Ensure -style-config is honored when applying replacements. The .clang-format
 // in %S/Inputs is a dump of the Google style so the same test can be used.
 // RUN: grep -Ev "// *[A-Z-]+:" %s > %t.cpp
 // RUN: clang-modernize -format -style=file -style-config=%S/Inputs -use-nullptr %t.cpp
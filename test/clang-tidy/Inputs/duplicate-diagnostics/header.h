@@ -0,0 +1 @@
+class A { A(int i); };
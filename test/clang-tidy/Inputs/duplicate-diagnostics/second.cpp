@@ -0,0 +1,2 @@
+#include "header.h"
+class C { C(int i); };
@@ -0,0 +1 @@
+class B { B(int i); };
@@ -0,0 +1,2 @@
+class C { C(int i); };
+class D { D(int i); };
@@ -0,0 +1 @@
+class H { H(int i); };
@@ -0,0 +1 @@
+#include "header.h"
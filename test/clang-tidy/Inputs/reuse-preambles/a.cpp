@@ -0,0 +1,3 @@
+#include "header.h"
+
+class A { A(int i); };
@@ -0,0 +1,3 @@
+#include "header.h"
+
+class B { B(int i); };
@@ -0,0 +1,3 @@
+#include "header.h"
+
+class C { C(int i); };
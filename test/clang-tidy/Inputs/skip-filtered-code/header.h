@@ -0,0 +1,5 @@
+class B { B(int); };
+
+void f(int x, int y);
+void g() {
+  f(
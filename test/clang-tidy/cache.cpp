@@ -0,0 +1,30 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: grep -Ev "// *[A-Z-]+:" %s > %t/input.cpp
+// RUN: clang-tidy %t/input.cpp -checks='-*,google-explicit-constructor' -cache-dir=%t/cache -- > %t/first.msg 2> %t/first.stats
+// RUN: FileCheck -input-file=%t/first.msg %s
+// RUN: FileCheck -input-file=%t/first.stats -check-prefix=MISS %s
+// RUN: clang-tidy %t/input.cpp -checks='-*,google-explicit-constructor' -cache-dir=%t/cache -- > %t/second.msg 2> %t/second.stats
+// RUN: FileCheck -input-file=%t/second.msg %s
+// RUN: FileCheck -input-file=%t/second.stats -check-prefix=HIT %s
+//
+// Different options must not use the cached results.
+// RUN: clang-tidy %t/input.cpp -checks='-*,google-explicit-constructor,llvm-namespace-comment' -cache-dir=%t/cache -- 2>&1 | FileCheck -check-prefix=MISS %s
+//
+// -system-headers isn't part of the YAML configuration, but changes the
+// results too.
+// RUN: clang-tidy %t/input.cpp -checks='-*,google-explicit-constructor' -system-headers -cache-dir=%t/cache -- 2>&1 | FileCheck -check-prefix=MISS %s
+// RUN: clang-tidy %t/input.cpp -checks='-*,google-explicit-constructor' -cache-dir=%t/cache -- 2>&1 | FileCheck -check-prefix=HIT %s
+//
+// The cache can't hold results that depend on the other files of the run.
+// RUN: not clang-tidy %t/input.cpp -checks='-*,google-explicit-constructor' -skip-checked-headers -cache-dir=%t/cache -- 2>&1 | FileCheck -check-prefix=SKIP %s
+//
+// Changed sources must not use the cached results.
+// RUN: echo "class B { B(int i); };" >> %t/input.cpp
+// RUN: clang-tidy %t/input.cpp -checks='-*,google-explicit-constructor' -cache-dir=%t/cache -- 2>&1 | FileCheck -check-prefix=MISS %s
+
+class A { A(int i); };
+// CHECK: input.cpp:{{[0-9]+}}:11: warning: Single-argument constructors must be explicit [google-explicit-constructor]
+
+// MISS: Cache: 0 hits, 1 misses.
+// HIT: Cache: 1 hits, 0 misses.
+// SKIP: Error: -skip-checked-headers can't be used with -cache-dir.
@@ -0,0 +1,15 @@
+// RUN: clang-tidy -checks='-*,google-explicit-constructor' -header-filter='header\.h' %s %S/Inputs/duplicate-diagnostics/second.cpp -- -I %S/Inputs/duplicate-diagnostics 2>&1 | FileCheck %s
+// RUN: clang-tidy -j 2 -checks='-*,google-explicit-constructor' -header-filter='header\.h' %s %S/Inputs/duplicate-diagnostics/second.cpp -- -I %S/Inputs/duplicate-diagnostics 2>&1 | FileCheck %s
+// RUN: clang-tidy -skip-checked-headers -checks='-*,google-explicit-constructor' -header-filter='header\.h' %s %S/Inputs/duplicate-diagnostics/second.cpp -- -I %S/Inputs/duplicate-diagnostics 2>&1 | FileCheck %s
+// RUN: clang-tidy -skip-checked-headers -checks='-*,google-explicit-constructor' -header-filter='header\.h' %s %S/Inputs/duplicate-diagnostics/second.cpp -- -I %S/Inputs/duplicate-diagnostics 2>&1 | FileCheck -check-prefix=CHECK-STATS %s
+
+// CHECK-STATS: Suppressed 1 warnings (1 in checked headers).
+
+#include "header.h"
+// CHECK: header.h:1:11: warning: Single-argument constructors must be explicit [google-explicit-constructor]
+
+class B { B(int i); };
+// CHECK: duplicate-diagnostics.cpp:[[@LINE-1]]:11: warning: Single-argument constructors must be explicit [google-explicit-constructor]
+// CHECK-NOT: header.h:
+// CHECK: second.cpp:2:11: warning: Single-argument constructors must be explicit [google-explicit-constructor]
+// CHECK-NOT: header.h:
@@ -0,0 +1,12 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: grep -Ev "// *[A-Z-]+:" %s > %t/input.cpp
+// RUN: clang-tidy %t/input.cpp -checks='-*,google-explicit-constructor,llvm-namespace-comment' -export-fixes=%t/fixes.fixes -export-fixes-binary --
+// RUN: clang-apply-replacements %t
+// RUN: FileCheck -input-file=%t/input.cpp %s
+
+namespace i {
+}
+// CHECK: } // namespace i
+
+class A { A(int i); };
+// CHECK: class A { explicit A(int i); };
@@ -0,0 +1,26 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: grep -Ev "// *[A-Z-]+:" %s > %t/a.cpp
+// RUN: cp %t/a.cpp %t/b.cpp
+// RUN: clang-tidy %t/a.cpp %t/b.cpp -checks='-*,google-explicit-constructor' -export-fixes=%t/fixes.yaml -- | FileCheck -check-prefix=CHECK-MESSAGES %s
+// RUN: FileCheck -input-file=%t/fixes.yaml -check-prefix=CHECK-YAML %s
+// RUN: clang-apply-replacements %t
+// RUN: FileCheck -input-file=%t/a.cpp %s
+// RUN: FileCheck -input-file=%t/b.cpp %s
+// RUN: clang-tidy %t/a.cpp -checks='-*,google-explicit-constructor' -export-fixes=%t/none.yaml --
+// RUN: not test -e %t/none.yaml
+
+// The fixes of all files are in a single document.
+// CHECK-YAML: ---
+// CHECK-YAML-NEXT: MainSourceFile: ''
+// CHECK-YAML: Replacements:
+// CHECK-YAML-NEXT: - FilePath:{{.*}}a.cpp
+// CHECK-YAML: ReplacementText: 'explicit '
+// CHECK-YAML-NEXT: - FilePath:{{.*}}b.cpp
+// CHECK-YAML: ReplacementText: 'explicit '
+// CHECK-YAML-NEXT: ...
+// CHECK-YAML-NOT: ---
+
+class A { A(int i); };
+// CHECK: class A { explicit A(int i); };
+// CHECK-MESSAGES: a.cpp:{{[0-9]+}}:11: warning: Single-argument constructors must be explicit
+// CHECK-MESSAGES: b.cpp:{{[0-9]+}}:11: warning: Single-argument constructors must be explicit
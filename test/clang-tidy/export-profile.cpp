@@ -0,0 +1,36 @@
+// RUN: clang-tidy -checks='-*,google-explicit-constructor,misc-use-override' -export-profile=%t.json %s -- > %t.log 2>&1
+// RUN: FileCheck -input-file=%t.json %s
+// RUN: clang-tidy -checks='-*,google-explicit-constructor,misc-use-override' -export-profile=%t.trace -export-profile-trace %s -- > %t.log 2>&1
+// RUN: FileCheck -input-file=%t.trace -check-prefix=TRACE %s
+
+class A { A(int i); };
+
+// CHECK: "translation_units": [
+// CHECK-NEXT: {
+// CHECK-NEXT: "file": "{{.*}}export-profile.cpp",
+// CHECK-NEXT: "start": 0.000000,
+// CHECK-NEXT: "parse": {{[0-9.]+}},
+// CHECK-NEXT: "matchers": {{[0-9.]+}},
+// CHECK-NEXT: "analyzer": {{[0-9.]+}},
+// CHECK-NEXT: "process_peak_rss_after": {{[0-9]+}},
+// CHECK-NEXT: "checks": {
+// CHECK-NEXT: "google-explicit-constructor": {{[0-9.]+}},
+// CHECK-NEXT: "misc-use-override": {{[0-9.]+}}
+// CHECK-NEXT: }
+// CHECK-NEXT: }
+// CHECK-NEXT: ],
+// CHECK-NEXT: "checks": {
+// CHECK-NEXT: "google-explicit-constructor": {{[0-9.]+}},
+// CHECK-NEXT: "misc-use-override": {{[0-9.]+}}
+// CHECK-NEXT: }
+
+// TRACE: "traceEvents": [
+// TRACE-NEXT: {"name": "{{.*}}export-profile.cpp", "cat": "translation-unit", "ph": "X", "pid": 1, "tid": 0, "ts": 0, "dur": {{[0-9]+}}, "args": {"process_peak_rss_after": {{[0-9]+}}}},
+// TRACE-NEXT: {"name": "parse", "cat": "phase", "ph": "X", "pid": 1, "tid": 0, "ts": 0, "dur": {{[0-9]+}}},
+// TRACE-NEXT: {"name": "matchers", "cat": "phase", "ph": "X", "pid": 1, "tid": 0, "ts": {{[0-9]+}}, "dur": {{[0-9]+}}, "args": {
+// TRACE-NEXT: "google-explicit-constructor": {{[0-9]+}},
+// TRACE-NEXT: "misc-use-override": {{[0-9]+}}
+// TRACE-NEXT: }},
+// TRACE-NEXT: {"name": "analyzer", "cat": "phase", "ph": "X", "pid": 1, "tid": 0, "ts": {{[0-9]+}}, "dur": {{[0-9]+}}}
+// TRACE-NEXT: ],
+// TRACE-NEXT: "displayTimeUnit": "ms"
@@ -0,0 +1,20 @@
+// RUN: clang-tidy %s -checks='-*,google-explicit-constructor,google-readability-todo,clang-analyzer-cplusplus.NewDelete' -- 2>&1 | FileCheck -implicit-check-not='{{warning:|error:}}' -check-prefix=CHECK-ALL %s
+// RUN: clang-tidy %s -checks='-*,google-explicit-constructor,google-readability-todo,clang-analyzer-cplusplus.NewDelete' -max-check-cost=ast-local -- 2>&1 | FileCheck -implicit-check-not='{{warning:|error:}}' -check-prefix=CHECK-AST %s
+// RUN: clang-tidy %s -checks='-*,google-explicit-constructor,google-readability-todo,clang-analyzer-cplusplus.NewDelete' -max-check-cost=ast-local -- -Xclang -analyzer-checker=cplusplus.NewDelete 2>&1 | FileCheck -implicit-check-not='{{warning:|error:}}' -check-prefix=CHECK-AST %s
+// RUN: clang-tidy %s -checks='-*,google-explicit-constructor,google-readability-todo,clang-analyzer-cplusplus.NewDelete' -max-check-cost=lexical -- 2>&1 | FileCheck -implicit-check-not='{{warning:|error:}}' -check-prefix=CHECK-LEX %s
+
+// TODO fix this
+// CHECK-ALL: :[[@LINE-1]]:1: warning: missing username/bug in TODO
+// CHECK-AST: :[[@LINE-2]]:1: warning: missing username/bug in TODO
+// CHECK-LEX: :[[@LINE-3]]:1: warning: missing username/bug in TODO
+
+class A { A(int i); };
+// CHECK-ALL: :[[@LINE-1]]:11: warning: Single-argument constructors must be explicit
+// CHECK-AST: :[[@LINE-2]]:11: warning: Single-argument constructors must be explicit
+
+void f() {
+  int *p = new int(42);
+  delete p;
+  delete p;
+  // CHECK-ALL: :[[@LINE-1]]:{{[0-9]+}}: warning: Attempt to free released memory
+}
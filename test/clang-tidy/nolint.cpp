@@ -6,6 +6,23 @@ class A { A(int i); };
 class B { B(int i); }; // NOLINT
 // CHECK-NOT: :[[@LINE-1]]:11: warning: Single-argument constructors must be explicit [google-explicit-constructor]
 
-class C { C(int i); }; // NOLINT(we-dont-care-about-categories-yet)
+class C { C(int i); }; // NOLINT(some-other-check)
+// CHECK: :[[@LINE-1]]:11: warning: Single-argument constructors must be explicit [google-explicit-constructor]
+
+class D { D(int i); }; // NOLINT(google-explicit-constructor)
+// CHECK-NOT: :[[@LINE-1]]:11: warning: Single-argument constructors must be explicit [google-explicit-constructor]
+
+class E { E(int i); }; // NOLINT(some-other-check, google-explicit-constructor)
+// CHECK-NOT: :[[@LINE-1]]:11: warning: Single-argument constructors must be explicit [google-explicit-constructor]
+
+class F { F(int i); }; // NOLINT(*)
+// CHECK-NOT: :[[@LINE-1]]:11: warning: Single-argument constructors must be explicit [google-explicit-constructor]
+
+class G { G(int i); }; // NOLINT(some-other-check
 // CHECK-NOT: :[[@LINE-1]]:11: warning: Single-argument constructors must be explicit [google-explicit-constructor]
-// CHECK: Suppressed 2 warnings (2 NOLINT)
+
+// NOLINT before the location doesn't apply to it.
+/* NOLINT */ class H { H(int i); };
+// CHECK: :[[@LINE-1]]:24: warning: Single-argument constructors must be explicit [google-explicit-constructor]
+
+// CHECK: Suppressed 5 warnings (5 NOLINT)
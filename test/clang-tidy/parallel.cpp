@@ -0,0 +1,8 @@
+// RUN: clang-tidy -j 3 -checks='-*,google-explicit-constructor' %s %S/Inputs/parallel/second.cpp %S/Inputs/parallel/third.cpp -- 2>&1 | FileCheck %s
+
+class A { A(int i); };
+// CHECK: parallel.cpp:[[@LINE-1]]:11: warning: Single-argument constructors must be explicit [google-explicit-constructor]
+// CHECK: second.cpp:1:11: warning: Single-argument constructors must be explicit [google-explicit-constructor]
+// CHECK: third.cpp:1:11: warning: Single-argument constructors must be explicit [google-explicit-constructor]
+// CHECK: third.cpp:2:11: warning: Single-argument constructors must be explicit [google-explicit-constructor]
+// CHECK-NOT: warning:
@@ -53,3 +53,19 @@ void bar2() { class A { void barx() {;;} }; }
 //
 // CHECK-MESSAGES: :[[@LINE-4]]:30: warning: function 'barx' exceeds recommended size/complexity
 // CHECK-MESSAGES: :[[@LINE-5]]:30: note: 2 statements (threshold 0)
+
+void baz0(int i) {
+  switch (i) {
+  case 0:
+    break;
+  case 1:
+  default:
+    break;
+  }
+L:
+  goto L;
+}
+// CHECK-MESSAGES: :[[@LINE-11]]:6: warning: function 'baz0' exceeds recommended size/complexity
+// CHECK-MESSAGES: :[[@LINE-12]]:6: note: 10 lines including whitespace and comments (threshold 0)
+// CHECK-MESSAGES: :[[@LINE-13]]:6: note: 4 statements (threshold 0)
+// CHECK-MESSAGES: :[[@LINE-14]]:6: note: 4 branches (threshold 0)
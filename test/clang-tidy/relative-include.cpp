@@ -0,0 +1,17 @@
+// RUN: rm -rf %t && mkdir -p %t/build
+// RUN: cp -r %S/Inputs/relative-include %t/src
+// RUN: echo '[{"directory": "%t/src", "command": "clang++ -Iinclude -c first.cpp", "file": "%t/src/first.cpp"}, {"directory": "%t/src", "command": "clang++ -Iinclude -c second.cpp", "file": "%t/src/second.cpp"}]' > %t/build/compile_commands.json
+// RUN: cd %t/build && clang-tidy -p %t/build -j 2 -checks='-*,google-explicit-constructor' -header-filter='.*' -fix -export-fixes=%t/fixes.yaml %t/src/first.cpp %t/src/second.cpp > %t/msg 2>&1
+// RUN: FileCheck -input-file=%t/msg -check-prefix=CHECK-MESSAGES %s
+// RUN: FileCheck -input-file=%t/fixes.yaml -check-prefix=CHECK-YAML %s
+// RUN: FileCheck -input-file=%t/src/include/header.h %s
+// REQUIRES: shell
+
+// Files found through a relative -I are reported and fixed relative to the
+// directory of the compile command, not the working directory of clang-tidy.
+
+// CHECK-MESSAGES: {{/.*}}/src/include/header.h:1:11: warning: Single-argument constructors must be explicit
+// CHECK-MESSAGES-NOT: warning:
+// CHECK-MESSAGES: clang-tidy applied 1 of 1 suggested fixes.
+// CHECK-YAML: FilePath: {{.*}}/src/include/header.h
+// CHECK: class H { explicit H(int i); };
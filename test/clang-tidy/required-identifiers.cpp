@@ -0,0 +1,24 @@
+// RUN: clang-tidy -checks='-*,google-explicit-constructor,llvm-twine-local' -export-profile=%t.json %s -- > %t.log 2>&1
+// RUN: FileCheck -input-file=%t.json -implicit-check-not=llvm-twine-local -check-prefix=CHECK-NONE %s
+// RUN: clang-tidy -checks='-*,google-explicit-constructor,llvm-twine-local' -export-profile=%t-twine.json %s -- -DUSE_TWINE > %t.log 2>&1
+// RUN: FileCheck -input-file=%t-twine.json -check-prefix=CHECK-TWINE %s
+
+// The matchers of llvm-twine-local only run in translation units in which its
+// class name appears.
+#ifdef USE_TWINE
+namespace llvm {
+class Twine;
+}
+#endif
+
+class A { A(int i); };
+int x;
+
+// CHECK-NONE: "checks": {
+// CHECK-NONE-NEXT: "google-explicit-constructor": {{[0-9.]+}}
+// CHECK-NONE-NEXT: }
+
+// CHECK-TWINE: "checks": {
+// CHECK-TWINE-NEXT: "google-explicit-constructor": {{[0-9.]+}},
+// CHECK-TWINE-NEXT: "llvm-twine-local": {{[0-9.]+}}
+// CHECK-TWINE-NEXT: }
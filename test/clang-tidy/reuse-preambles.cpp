@@ -0,0 +1,19 @@
+// RUN: clang-tidy -reuse-preambles -checks='-*,google-explicit-constructor' -header-filter='header\.h' %S/Inputs/reuse-preambles/a.cpp %S/Inputs/reuse-preambles/b.cpp %S/Inputs/reuse-preambles/c.cpp -- 2>&1 | FileCheck %s
+// RUN: clang-tidy -reuse-preambles -j 2 -checks='-*,google-explicit-constructor' -header-filter='header\.h' %S/Inputs/reuse-preambles/a.cpp %S/Inputs/reuse-preambles/b.cpp %S/Inputs/reuse-preambles/c.cpp -- 2>&1 | FileCheck --check-prefix=CHECK-PARALLEL %s
+// RUN: clang-tidy -reuse-preambles -checks='-*,google-explicit-constructor,llvm-include-order' %S/Inputs/reuse-preambles/a.cpp %S/Inputs/reuse-preambles/b.cpp -- 2>&1 | FileCheck --check-prefix=CHECK-PP %s
+
+// CHECK: a.cpp:3:11: warning: Single-argument constructors must be explicit [google-explicit-constructor]
+// CHECK: header.h:1:11: warning: Single-argument constructors must be explicit [google-explicit-constructor]
+// CHECK: b.cpp:3:11: warning: Single-argument constructors must be explicit [google-explicit-constructor]
+// CHECK: c.cpp:3:11: warning: Single-argument constructors must be explicit [google-explicit-constructor]
+// CHECK: Preambles: 1 built, 2 reused.
+
+// CHECK-PARALLEL: a.cpp:3:11: warning
+// CHECK-PARALLEL: header.h:1:11: warning
+// CHECK-PARALLEL: b.cpp:3:11: warning
+// CHECK-PARALLEL: c.cpp:3:11: warning
+
+// Checks with PPCallbacks see the preamble directives: no PCH is built.
+// CHECK-PP: a.cpp:3:11: warning
+// CHECK-PP: b.cpp:3:11: warning
+// CHECK-PP-NOT: Preambles:
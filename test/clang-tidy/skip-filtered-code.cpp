@@ -0,0 +1,16 @@
+// RUN: clang-tidy -checks='-*,google-explicit-constructor,misc-argument-comment' -skip-filtered-code %s -- -I %S/Inputs/skip-filtered-code 2>&1 | FileCheck %s
+
+// The call starts in the header, but misc-argument-comment isn't
+// location-local: it warns about the comments of the arguments.
+#include "header.h"
+    0, /*z=*/0);
+// CHECK-NOT: header.h:{{.*}} warning:
+// CHECK: :[[@LINE-2]]:8: warning: argument name 'z' in comment does not match parameter name 'y' [misc-argument-comment]
+}
+
+class A { A(int); };
+// CHECK: :[[@LINE-1]]:11: warning: Single-argument constructors must be explicit [google-explicit-constructor]
+
+// CHECK-NOT: warning:
+
+// REQUIRES: shell
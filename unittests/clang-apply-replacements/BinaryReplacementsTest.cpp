@@ -0,0 +1,135 @@
+//===- clang-apply-replacements/BinaryReplacementsTest.cpp ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang-apply-replacements/Tooling/BinaryReplacements.h"
+#include "clang/Tooling/ReplacementsYaml.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#include <chrono>
+
+using namespace clang;
+using namespace clang::tooling;
+using namespace clang::replace;
+
+static TranslationUnitReplacements makeTU() {
+  TranslationUnitReplacements TU;
+  TU.MainSourceFile = "/path/to/source.cpp";
+  TU.Replacements.push_back(Replacement("/path/to/header.h", 10, 4, "auto"));
+  TU.Replacements.push_back(Replacement("/path/to/source.cpp", 0, 0, ""));
+  TU.Replacements.push_back(
+      Replacement("/path/to/header.h", 300000, 12, "override \n"));
+  return TU;
+}
+
+static std::string writeBinary(const TranslationUnitReplacements &TU) {
+  std::string Buffer;
+  llvm::raw_string_ostream OS(Buffer);
+  writeBinaryReplacements(TU, OS);
+  return OS.str();
+}
+
+TEST(BinaryReplacementsTest, roundTrips) {
+  TranslationUnitReplacements TU = makeTU();
+  std::string Buffer = writeBinary(TU);
+  EXPECT_TRUE(isBinaryReplacements(Buffer));
+
+  TranslationUnitReplacements Read;
+  ASSERT_TRUE(readBinaryReplacements(Buffer, Read));
+  EXPECT_EQ(TU.MainSourceFile, Read.MainSourceFile);
+  ASSERT_EQ(TU.Replacements.size(), Read.Replacements.size());
+  for (unsigned I = 0, E = TU.Replacements.size(); I != E; ++I) {
+    EXPECT_EQ(TU.Replacements[I].getFilePath(),
+              Read.Replacements[I].getFilePath());
+    EXPECT_EQ(TU.Replacements[I].getOffset(), Read.Replacements[I].getOffset());
+    EXPECT_EQ(TU.Replacements[I].getLength(), Read.Replacements[I].getLength());
+    EXPECT_EQ(TU.Replacements[I].getReplacementText(),
+              Read.Replacements[I].getReplacementText());
+  }
+}
+
+TEST(BinaryReplacementsTest, roundTripsEmpty) {
+  TranslationUnitReplacements TU;
+  TranslationUnitReplacements Read;
+  ASSERT_TRUE(readBinaryReplacements(writeBinary(TU), Read));
+  EXPECT_TRUE(Read.MainSourceFile.empty());
+  EXPECT_TRUE(Read.Replacements.empty());
+}
+
+TEST(BinaryReplacementsTest, storesPathsOnce) {
+  TranslationUnitReplacements TU;
+  std::string Path(200, 'p');
+  for (unsigned I = 0; I != 100; ++I)
+    TU.Replacements.push_back(Replacement(Path, I, 1, ""));
+  EXPECT_LT(writeBinary(TU).size(), 2 * Path.size());
+}
+
+TEST(BinaryReplacementsTest, rejectsYAML) {
+  std::string Buffer;
+  llvm::raw_string_ostream OS(Buffer);
+  llvm::yaml::Output YAML(OS);
+  TranslationUnitReplacements TU = makeTU();
+  YAML << TU;
+
+  TranslationUnitReplacements Read;
+  EXPECT_FALSE(isBinaryReplacements(OS.str()));
+  EXPECT_FALSE(readBinaryReplacements(OS.str(), Read));
+}
+
+TEST(BinaryReplacementsTest, rejectsTruncatedInput) {
+  std::string Buffer = writeBinary(makeTU());
+  TranslationUnitReplacements Read;
+  for (unsigned Size = 0, E = Buffer.size(); Size != E; ++Size)
+    EXPECT_FALSE(readBinaryReplacements(Buffer.substr(0, Size), Read))
+        << "Size: " << Size;
+}
+
+// Compares the throughput of the binary format with YAML. Run with
+// --gtest_also_run_disabled_tests.
+TEST(BinaryReplacementsTest, DISABLED_throughput) {
+  TranslationUnitReplacements TU;
+  TU.MainSourceFile = "/home/user/project/lib/Component/Source.cpp";
+  for (unsigned I = 0; I != 200000; ++I)
+    TU.Replacements.push_back(Replacement(
+        "/home/user/project/include/Component/Header" + std::to_string(I % 50) +
+            ".h",
+        I * 10, 4, "nullptr"));
+
+  typedef std::chrono::steady_clock Clock;
+  auto Milliseconds = [](Clock::duration D) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(D).count();
+  };
+
+  Clock::time_point Start = Clock::now();
+  std::string YAMLBuffer;
+  {
+    llvm::raw_string_ostream OS(YAMLBuffer);
+    llvm::yaml::Output YAML(OS);
+    YAML << TU;
+  }
+  Clock::time_point YAMLWritten = Clock::now();
+  TranslationUnitReplacements YAMLRead;
+  llvm::yaml::Input YIn(YAMLBuffer);
+  YIn >> YAMLRead;
+  Clock::time_point YAMLDone = Clock::now();
+  ASSERT_FALSE(YIn.error());
+
+  std::string BinaryBuffer = writeBinary(TU);
+  Clock::time_point BinaryWritten = Clock::now();
+  TranslationUnitReplacements BinaryRead;
+  ASSERT_TRUE(readBinaryReplacements(BinaryBuffer, BinaryRead));
+  Clock::time_point BinaryDone = Clock::now();
+
+  EXPECT_EQ(YAMLRead.Replacements.size(), BinaryRead.Replacements.size());
+  llvm::outs() << "YAML:   " << YAMLBuffer.size() << " bytes, write "
+               << Milliseconds(YAMLWritten - Start) << " ms, read "
+               << Milliseconds(YAMLDone - YAMLWritten) << " ms\n"
+               << "Binary: " << BinaryBuffer.size() << " bytes, write "
+               << Milliseconds(BinaryWritten - YAMLDone) << " ms, read "
+               << Milliseconds(BinaryDone - BinaryWritten) << " ms\n";
+}
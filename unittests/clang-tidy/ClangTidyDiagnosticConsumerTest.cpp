@@ -1,5 +1,8 @@
 #include "ClangTidy.h"
 #include "ClangTidyTest.h"
+#include "clang/Tooling/ReplacementsYaml.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "gtest/gtest.h"
 
 namespace clang {
@@ -29,6 +32,47 @@ TEST(ClangTidyDiagnosticConsumer, SortsErrors) {
   EXPECT_EQ("variable", Errors[1].Message.Message);
 }
 
+// Reports the tokens following the name of each variable, up to the ';'.
+class TokenIndexCheck : public ClangTidyCheck {
+public:
+  TokenIndexCheck(StringRef Name, ClangTidyContext *Context)
+      : ClangTidyCheck(Name, Context) {}
+  void registerMatchers(ast_matchers::MatchFinder *Finder) override {
+    Finder->addMatcher(ast_matchers::varDecl().bind("var"), this);
+  }
+  void check(const ast_matchers::MatchFinder::MatchResult &Result) override {
+    const VarDecl *Var = Result.Nodes.getNodeAs<VarDecl>("var");
+    const SourceManager &SM = *Result.SourceManager;
+    const TokenIndex &Index =
+        getTokenIndex(SM, SM.getFileID(Var->getLocation()),
+                      Result.Context->getLangOpts());
+    // The index is shared by all matches in the file.
+    EXPECT_EQ(&Index, &getTokenIndex(SM, SM.getFileID(Var->getLocation()),
+                                     Result.Context->getLangOpts()));
+    ArrayRef<Token> Tokens = Index.tokens();
+    for (size_t I = Index.find(Var->getLocation()) + 1;
+         Tokens[I].isNot(tok::semi) && Tokens[I].isNot(tok::eof); ++I)
+      diag(Tokens[I].getLocation(), tok::getTokenName(Tokens[I].getKind()));
+  }
+};
+
+TEST(TokenIndex, FindsTokensAndComments) {
+  std::vector<ClangTidyError> Errors;
+  runCheckOnCode<TokenIndexCheck>("int a /* c */ = 1;\n"
+                                  "int  b=2 // c\n"
+                                  ";",
+                                  &Errors);
+  ASSERT_EQ(6u, Errors.size());
+  EXPECT_EQ("comment", Errors[0].Message.Message);
+  EXPECT_EQ(6u, Errors[0].Message.FileOffset);
+  EXPECT_EQ("equal", Errors[1].Message.Message);
+  EXPECT_EQ("numeric_constant", Errors[2].Message.Message);
+  EXPECT_EQ("equal", Errors[3].Message.Message);
+  EXPECT_EQ(25u, Errors[3].Message.FileOffset);
+  EXPECT_EQ("numeric_constant", Errors[4].Message.Message);
+  EXPECT_EQ("comment", Errors[5].Message.Message);
+}
+
 TEST(GlobList, Empty) {
   GlobList Filter("");
 
@@ -82,6 +126,117 @@ TEST(GlobList, Complex) {
   EXPECT_TRUE(Filter.contains("asdfqwEasdf"));
 }
 
+TEST(GlobList, LastMatchWins) {
+  GlobList Filter("a*c,-abc,*c,-a*b*c,abbc");
+
+  for (int Pass = 0; Pass < 2; ++Pass) {
+    EXPECT_FALSE(Filter.contains("abc"));
+    EXPECT_TRUE(Filter.contains("abbc"));
+    EXPECT_FALSE(Filter.contains("axbyc"));
+    EXPECT_TRUE(Filter.contains("axc"));
+    EXPECT_TRUE(Filter.contains("xc"));
+    EXPECT_FALSE(Filter.contains("ab"));
+    EXPECT_FALSE(Filter.contains("c*"));
+  }
+}
+
+TEST(LineFilterIndex, FirstMatchingFileWins) {
+  std::vector<FileFilter> LineFilter(3);
+  LineFilter[0].Name = "b.cpp";
+  LineFilter[0].LineRanges.push_back(FileFilter::LineRange(20, 30));
+  LineFilter[1].Name = "xab.cpp";
+  LineFilter[2].Name = "b.cpp";
+  LineFilter[2].LineRanges.push_back(FileFilter::LineRange(1, 5));
+  LineFilterIndex Index(LineFilter);
+
+  EXPECT_EQ(nullptr, Index.lookup("a.cpp"));
+  const LineFilterIndex::FileLines *Lines = Index.lookup("dir/xab.cpp");
+  ASSERT_NE(nullptr, Lines);
+  EXPECT_FALSE(Lines->contains(1));
+  EXPECT_TRUE(Lines->contains(20));
+  // The second filter for b.cpp is never used.
+  Lines = Index.lookup("b.cpp");
+  ASSERT_NE(nullptr, Lines);
+  EXPECT_FALSE(Lines->contains(1));
+}
+
+TEST(LineFilterIndex, MergesRanges) {
+  std::vector<FileFilter> LineFilter(1);
+  LineFilter[0].Name = "a.cpp";
+  LineFilter[0].LineRanges.push_back(FileFilter::LineRange(40, 50));
+  LineFilter[0].LineRanges.push_back(FileFilter::LineRange(10, 20));
+  LineFilter[0].LineRanges.push_back(FileFilter::LineRange(21, 25));
+  LineFilter[0].LineRanges.push_back(FileFilter::LineRange(12, 14));
+  LineFilter[0].LineRanges.push_back(FileFilter::LineRange(60, 55));
+  LineFilterIndex Index(LineFilter);
+
+  const LineFilterIndex::FileLines *Lines = Index.lookup("a.cpp");
+  ASSERT_NE(nullptr, Lines);
+  EXPECT_FALSE(Lines->contains(9));
+  EXPECT_TRUE(Lines->contains(10));
+  EXPECT_TRUE(Lines->contains(21));
+  EXPECT_TRUE(Lines->contains(25));
+  EXPECT_FALSE(Lines->contains(26));
+  EXPECT_TRUE(Lines->contains(50));
+  EXPECT_FALSE(Lines->contains(57));
+}
+
+static ClangTidyError makeError(StringRef CheckName, StringRef Message,
+                                StringRef FilePath, unsigned FileOffset) {
+  ClangTidyError Error(CheckName, ClangTidyError::Warning);
+  Error.Message.Message = Message;
+  Error.Message.FilePath = FilePath;
+  Error.Message.FileOffset = FileOffset;
+  return Error;
+}
+
+TEST(ClangTidyErrorSet, IdentifiesErrorsByCheckLocationAndMessage) {
+  ClangTidyErrorSet Errors;
+  EXPECT_TRUE(Errors.insert(makeError("check", "message", "a.cpp", 10)));
+  EXPECT_FALSE(Errors.insert(makeError("check", "message", "a.cpp", 10)));
+  EXPECT_TRUE(Errors.insert(makeError("other", "message", "a.cpp", 10)));
+  EXPECT_TRUE(Errors.insert(makeError("check", "other", "a.cpp", 10)));
+  EXPECT_TRUE(Errors.insert(makeError("check", "message", "b.cpp", 10)));
+  EXPECT_TRUE(Errors.insert(makeError("check", "message", "a.cpp", 11)));
+  // Field boundaries are part of the digest.
+  EXPECT_TRUE(Errors.insert(makeError("check", "essage", "a.cppm", 10)));
+
+  Errors.clear();
+  EXPECT_TRUE(Errors.insert(makeError("check", "message", "a.cpp", 10)));
+}
+
+TEST(ReplacementsExporter, QuotesYAMLStrings) {
+  llvm::SmallString<128> Path;
+  ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("fixes", "yaml", Path));
+
+  const char *Texts[] = {"explicit ", "it's", "a\nb\t\"c\"\\", "-", ""};
+  ClangTidyError Error = makeError("check", "message", "a.cpp", 0);
+  for (unsigned I = 0; I != llvm::array_lengthof(Texts); ++I)
+    Error.Fix.insert(tooling::Replacement("/dir/a b.cpp", I, 0, Texts[I]));
+
+  std::error_code EC;
+  std::unique_ptr<ClangTidyErrorSink> Exporter =
+      createReplacementsExporter(Path, /*Binary=*/false, EC);
+  Exporter->handleErrors("a.cpp", Error);
+  Exporter->finish();
+  ASSERT_FALSE(EC);
+
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Buffer =
+      llvm::MemoryBuffer::getFile(Path);
+  ASSERT_TRUE(!!Buffer);
+  tooling::TranslationUnitReplacements TUR;
+  llvm::yaml::Input YAML((*Buffer)->getBuffer());
+  YAML >> TUR;
+  ASSERT_FALSE(YAML.error());
+  ASSERT_EQ(llvm::array_lengthof(Texts), TUR.Replacements.size());
+  for (unsigned I = 0; I != llvm::array_lengthof(Texts); ++I) {
+    EXPECT_EQ("/dir/a b.cpp", TUR.Replacements[I].getFilePath());
+    EXPECT_EQ(I, TUR.Replacements[I].getOffset());
+    EXPECT_EQ(Texts[I], TUR.Replacements[I].getReplacementText());
+  }
+  llvm::sys::fs::remove(Path);
+}
+
 } // namespace test
 } // namespace tidy
 } // namespace clang
@@ -1,4 +1,8 @@
 #include "ClangTidyOptions.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 
 namespace clang {
@@ -59,14 +63,71 @@ TEST(ParseConfiguration, ValidConfiguration) {
       parseConfiguration("Checks: \"-*,misc-*\"\n"
                          "HeaderFilterRegex: \".*\"\n"
                          "AnalyzeTemporaryDtors: true\n"
+                         "AnalyzerMaxNodes: 1000\n"
                          "User: some.user");
   EXPECT_TRUE(!!Options);
   EXPECT_EQ("-*,misc-*", *Options->Checks);
   EXPECT_EQ(".*", *Options->HeaderFilterRegex);
   EXPECT_TRUE(*Options->AnalyzeTemporaryDtors);
+  EXPECT_EQ(1000u, *Options->AnalyzerMaxNodes);
   EXPECT_EQ("some.user", *Options->User);
 }
 
+static void writeFile(llvm::StringRef Path, llvm::StringRef Contents) {
+  std::error_code EC;
+  llvm::raw_fd_ostream OS(Path, EC, llvm::sys::fs::F_None);
+  EXPECT_FALSE(EC);
+  OS << Contents;
+}
+
+static std::string makePath(llvm::StringRef Directory, llvm::StringRef Name) {
+  llvm::SmallString<128> Path(Directory);
+  llvm::sys::path::append(Path, Name);
+  return Path.str();
+}
+
+TEST(FileOptionsProvider, CachesDirectories) {
+  llvm::SmallString<128> Root;
+  ASSERT_FALSE(
+      llvm::sys::fs::createUniqueDirectory("clang-tidy-options", Root));
+  std::string Sub = makePath(Root, "sub");
+  ASSERT_FALSE(llvm::sys::fs::create_directory(Sub));
+  std::string Other = makePath(Root, "other");
+  ASSERT_FALSE(llvm::sys::fs::create_directory(Other));
+  std::string Config = makePath(Root, ".clang-tidy");
+  writeFile(Config, "Checks: \"-*,misc-*\"\n");
+  std::string OtherConfig = makePath(Other, ".clang-tidy");
+  writeFile(OtherConfig, "Checks: \"-*,llvm-*\"\n");
+
+  ClangTidyOptions Defaults;
+  Defaults.Checks = "";
+  FileOptionsProvider Provider(ClangTidyGlobalOptions(), Defaults,
+                               ClangTidyOptions());
+  const ClangTidyOptions &Options = Provider.getOptions(makePath(Sub, "a.cpp"));
+  EXPECT_EQ("-*,misc-*", *Options.Checks);
+  // The directory without a configuration file shares the options of its
+  // parent.
+  EXPECT_EQ(&Options, &Provider.getOptions(makePath(Sub, "b.cpp")));
+  EXPECT_EQ(&Options, &Provider.getOptions(makePath(Root, "c.cpp")));
+  EXPECT_EQ("-*,llvm-*", *Provider.getOptions(makePath(Other, "d.cpp")).Checks);
+  EXPECT_FALSE(Provider.invalidateChangedConfigFiles(makePath(Sub, "a.cpp")));
+
+  writeFile(Config, "Checks: \"-*,google-*\"\n");
+  // Only the configuration files the options of the file depend on are
+  // checked.
+  EXPECT_FALSE(Provider.invalidateChangedConfigFiles(makePath(Other, "d.cpp")));
+  EXPECT_TRUE(Provider.invalidateChangedConfigFiles(makePath(Sub, "a.cpp")));
+  EXPECT_EQ("-*,google-*", *Provider.getOptions(makePath(Sub, "a.cpp")).Checks);
+  // Earlier results stay valid.
+  EXPECT_EQ("-*,misc-*", *Options.Checks);
+
+  llvm::sys::fs::remove(Config);
+  llvm::sys::fs::remove(OtherConfig);
+  llvm::sys::fs::remove(Sub);
+  llvm::sys::fs::remove(Other);
+  llvm::sys::fs::remove(Root.str());
+}
+
 } // namespace test
 } // namespace tidy
 } // namespace clang
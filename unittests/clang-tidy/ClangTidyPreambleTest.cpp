@@ -0,0 +1,164 @@
+//===- clang-tidy/ClangTidyPreambleTest.cpp -------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "ClangTidy.h"
+#include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#include <chrono>
+#include <tuple>
+
+namespace clang {
+namespace tidy {
+
+// Checks are registered by the modules, force linking the one used here.
+extern volatile int GoogleModuleAnchorSource;
+static int GoogleModuleAnchorDestination = GoogleModuleAnchorSource;
+
+namespace test {
+
+namespace {
+
+/// \brief Source files sharing a header, in a temporary directory.
+class Corpus {
+public:
+  /// \brief Creates \p NumFiles source files including a header with
+  /// \p NumClasses class templates.
+  Corpus(unsigned NumFiles, unsigned NumClasses) {
+    EXPECT_FALSE(llvm::sys::fs::createUniqueDirectory("clang-tidy-preamble",
+                                                      Directory));
+    std::string Header;
+    llvm::raw_string_ostream HeaderOS(Header);
+    for (unsigned I = 0; I != NumClasses; ++I)
+      HeaderOS << "template <typename T> class Base" << I << " {\n"
+               << "public:\n"
+               << "  Base" << I << "(T Value) : Value(Value) {}\n"
+               << "  T get() const { return Value; }\n"
+               << "  void set(T V) { Value = V; }\n"
+               << "private:\n"
+               << "  T Value;\n"
+               << "};\n";
+    writeFile("common.h", HeaderOS.str());
+
+    for (unsigned I = 0; I != NumFiles; ++I) {
+      std::string Name = "source" + std::to_string(I) + ".cpp";
+      writeFile(Name, "#include \"common.h\"\n\n"
+                      "class Derived : public Base0<int> {\n"
+                      "  Derived(int I) : Base0<int>(I) {}\n"
+                      "};\n");
+      SmallString<128> Path(Directory);
+      llvm::sys::path::append(Path, Name);
+      Sources.push_back(Path.str());
+    }
+  }
+
+  ~Corpus() {
+    for (const std::string &Path : Files)
+      llvm::sys::fs::remove(Path);
+    llvm::sys::fs::remove(Directory.str());
+  }
+
+  ClangTidyStats run(bool ReusePreambles, std::vector<ClangTidyError> &Errors) {
+    ClangTidyOptions Options;
+    Options.Checks = "-*,google-explicit-constructor";
+    Options.HeaderFilterRegex = ".*";
+    tooling::FixedCompilationDatabase Compilations(
+        Directory.str(), std::vector<std::string>(1, "-std=c++11"));
+    return runClangTidy(llvm::make_unique<DefaultOptionsProvider>(
+                            ClangTidyGlobalOptions(),
+                            ClangTidyOptions::getDefaults().mergeWith(Options)),
+                        Compilations, Sources, &Errors,
+                        /*Profile=*/nullptr, /*NumThreads=*/1,
+                        /*CacheDirectory=*/StringRef(), ReusePreambles);
+  }
+
+  std::vector<std::string> Sources;
+
+private:
+  void writeFile(StringRef Name, StringRef Contents) {
+    SmallString<128> Path(Directory);
+    llvm::sys::path::append(Path, Name);
+    std::error_code EC;
+    llvm::raw_fd_ostream OS(Path, EC, llvm::sys::fs::F_None);
+    EXPECT_FALSE(EC);
+    OS << Contents;
+    Files.push_back(Path.str());
+  }
+
+  SmallString<128> Directory;
+  std::vector<std::string> Files;
+};
+
+bool sameErrors(const std::vector<ClangTidyError> &LHS,
+                const std::vector<ClangTidyError> &RHS) {
+  if (LHS.size() != RHS.size())
+    return false;
+  for (size_t I = 0, E = LHS.size(); I != E; ++I) {
+    const ClangTidyMessage &M1 = LHS[I].Message;
+    const ClangTidyMessage &M2 = RHS[I].Message;
+    if (std::tie(LHS[I].CheckName, M1.FilePath, M1.FileOffset, M1.Message) !=
+        std::tie(RHS[I].CheckName, M2.FilePath, M2.FileOffset, M2.Message))
+      return false;
+  }
+  return true;
+}
+
+} // end anonymous namespace
+
+TEST(ClangTidyPreambleTest, SameResults) {
+  Corpus Files(3, 1);
+  std::vector<ClangTidyError> ColdErrors;
+  ClangTidyStats ColdStats = Files.run(false, ColdErrors);
+  std::vector<ClangTidyError> Errors;
+  ClangTidyStats Stats = Files.run(true, Errors);
+
+  // At least one warning per source file, and the ones in the header.
+  EXPECT_LT(3u, ColdErrors.size());
+  EXPECT_TRUE(sameErrors(ColdErrors, Errors));
+  EXPECT_EQ(ColdStats.ErrorsDisplayed, Stats.ErrorsDisplayed);
+  EXPECT_EQ(0u, ColdStats.PreamblesBuilt);
+  // The first file is processed without the PCH, which is built for the
+  // second one.
+  EXPECT_EQ(1u, Stats.PreamblesBuilt);
+  EXPECT_EQ(2u, Stats.PreamblesReused);
+}
+
+// Prints the time spent per translation unit with and without preambles on a
+// header-heavy corpus. Run with --gtest_also_run_disabled_tests.
+TEST(ClangTidyPreambleTest, DISABLED_FrontendTime) {
+  const unsigned NumFiles = 50;
+  Corpus Files(NumFiles, 5000);
+
+  typedef std::chrono::steady_clock Clock;
+  auto Milliseconds = [](Clock::duration D) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(D).count();
+  };
+
+  Clock::time_point Start = Clock::now();
+  std::vector<ClangTidyError> ColdErrors;
+  Files.run(false, ColdErrors);
+  Clock::time_point ColdDone = Clock::now();
+  std::vector<ClangTidyError> Errors;
+  ClangTidyStats Stats = Files.run(true, Errors);
+  Clock::time_point Done = Clock::now();
+
+  EXPECT_TRUE(sameErrors(ColdErrors, Errors));
+  EXPECT_EQ(NumFiles - 1, Stats.PreamblesReused);
+  llvm::outs() << "Without preambles: "
+               << Milliseconds(ColdDone - Start) / NumFiles << " ms per file\n"
+               << "With preambles:    "
+               << Milliseconds(Done - ColdDone) / NumFiles << " ms per file\n";
+}
+
+} // namespace test
+} // namespace tidy
+} // namespace clang
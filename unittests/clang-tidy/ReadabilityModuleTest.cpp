@@ -1,11 +1,15 @@
 #include "ClangTidyTest.h"
+#include "readability/FunctionSize.h"
 #include "readability/NamespaceCommentCheck.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
+#include <chrono>
 
 namespace clang {
 namespace tidy {
 namespace test {
 
+using readability::FunctionSizeCheck;
 using readability::NamespaceCommentCheck;
 
 TEST(NamespaceCommentCheckTest, Basic) {
@@ -94,6 +98,53 @@ TEST(NamespaceCommentCheckTest, FixWrongComments) {
                                                   "} // namespace asdf"));
 }
 
+// Returns a function with \p NumStatements statements, one in ten of them a
+// loop.
+static std::string generateFunction(unsigned NumStatements) {
+  std::string Code;
+  llvm::raw_string_ostream OS(Code);
+  OS << "void f(int i) {\n";
+  for (unsigned I = 0; I != NumStatements; ++I)
+    OS << (I % 10 ? "  i = i + 1;\n" : "  while (i) {}\n");
+  OS << "}\n";
+  return OS.str();
+}
+
+static std::string getNote(const std::vector<ClangTidyError> &Errors,
+                           StringRef Suffix) {
+  for (const ClangTidyError &Error : Errors)
+    for (const ClangTidyMessage &Note : Error.Notes)
+      if (StringRef(Note.Message).endswith(Suffix))
+        return Note.Message;
+  return "";
+}
+
+TEST(FunctionSizeCheckTest, CountsGeneratedFunction) {
+  std::vector<ClangTidyError> Errors;
+  runCheckOnCode<FunctionSizeCheck>(generateFunction(1000), &Errors);
+  // Each loop also counts its condition.
+  EXPECT_EQ("1100 statements (threshold 800)",
+            getNote(Errors, "(threshold 800)"));
+}
+
+// Prints the time spent on a function with 100k statements. Run with
+// --gtest_also_run_disabled_tests.
+TEST(FunctionSizeCheckTest, DISABLED_LargeFunctionTime) {
+  std::string Code = generateFunction(100000);
+  typedef std::chrono::steady_clock Clock;
+  Clock::time_point Start = Clock::now();
+  std::vector<ClangTidyError> Errors;
+  runCheckOnCode<FunctionSizeCheck>(Code, &Errors);
+  Clock::time_point Done = Clock::now();
+
+  EXPECT_EQ("110000 statements (threshold 800)",
+            getNote(Errors, "(threshold 800)"));
+  llvm::outs() << "100000 statements: "
+               << std::chrono::duration_cast<std::chrono::milliseconds>(
+                      Done - Start).count()
+               << " ms\n";
+}
+
 } // namespace test
 } // namespace tidy
 } // namespace clang